@@ -0,0 +1,388 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "../src/core/Console.h"
+#include "../src/core/ContentBlockingManager.h"
+#include "../src/core/ContentBlockingProfile.h"
+#include "../src/core/SessionsManager.h"
+#include "../src/core/SettingsManager.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTextStream>
+
+#include <algorithm>
+
+using namespace Otter;
+
+struct BenchmarkRequest
+{
+	QUrl baseUrl;
+	QUrl requestUrl;
+	NetworkManager::ResourceType resourceType = NetworkManager::OtherType;
+};
+
+QTextStream output(stdout);
+
+QHash<QString, NetworkManager::ResourceType> resourceTypes({{QLatin1String("other"), NetworkManager::OtherType}, {QLatin1String("main_frame"), NetworkManager::MainFrameType}, {QLatin1String("sub_frame"), NetworkManager::SubFrameType}, {QLatin1String("stylesheet"), NetworkManager::StyleSheetType}, {QLatin1String("script"), NetworkManager::ScriptType}, {QLatin1String("image"), NetworkManager::ImageType}, {QLatin1String("object"), NetworkManager::ObjectType}, {QLatin1String("object_subrequest"), NetworkManager::ObjectSubrequestType}, {QLatin1String("xmlhttprequest"), NetworkManager::XmlHttpRequestType}, {QLatin1String("websocket"), NetworkManager::WebSocketType}});
+
+qint64 getMemoryUsage(const QByteArray &field)
+{
+	QFile file(QLatin1String("/proc/self/status"));
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		return -1;
+	}
+
+	while (!file.atEnd())
+	{
+		const QByteArray line(file.readLine());
+
+		if (line.startsWith(field + ':'))
+		{
+			return line.mid(field.length() + 1).trimmed().split(' ').value(0).toLongLong();
+		}
+	}
+
+	return -1;
+}
+
+QString formatMemoryUsage(qint64 kilobytes)
+{
+	return ((kilobytes < 0) ? QLatin1String("unavailable") : QStringLiteral("%1 KiB").arg(kilobytes));
+}
+
+QString formatResult(const ContentBlockingManager::CheckResult &result)
+{
+	if (result.isException)
+	{
+		return QLatin1String("exception");
+	}
+
+	return (result.isBlocked ? QLatin1String("blocked") : QLatin1String("allowed"));
+}
+
+bool loadCorpus(const QString &path, QVector<BenchmarkRequest> &requests)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		output << "Failed to open corpus file: " << file.errorString() << endl;
+
+		return false;
+	}
+
+	QTextStream stream(&file);
+	int lineNumber(0);
+
+	while (!stream.atEnd())
+	{
+		const QString line(stream.readLine().trimmed());
+
+		++lineNumber;
+
+		if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+		{
+			continue;
+		}
+
+		const QStringList fields(line.split(QLatin1Char('\t')));
+
+		if (fields.count() < 2)
+		{
+			output << "Skipping malformed corpus line " << lineNumber << endl;
+
+			continue;
+		}
+
+		BenchmarkRequest request;
+		request.baseUrl = QUrl(fields.at(0));
+		request.requestUrl = QUrl(fields.at(1));
+		request.resourceType = resourceTypes.value(fields.value(2).toLower(), NetworkManager::OtherType);
+
+		requests.append(request);
+	}
+
+	return true;
+}
+
+int countRules(const QString &path)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		return 0;
+	}
+
+	QTextStream stream(&file);
+	int amount(0);
+
+	stream.readLine();
+
+	while (!stream.atEnd())
+	{
+		const QString line(stream.readLine().trimmed());
+
+		if (!line.isEmpty() && !line.startsWith(QLatin1Char('!')))
+		{
+			++amount;
+		}
+	}
+
+	return amount;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication application(argc, argv);
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QLatin1String("Replays recorded requests through content blocking and reports its performance"));
+	parser.addHelpOption();
+	parser.addPositionalArgument(QLatin1String("corpus"), QLatin1String("File with tab separated base URL, request URL and resource type triples"), QLatin1String("<corpus>"));
+	parser.addOption(QCommandLineOption(QLatin1String("list"), QLatin1String("Loads Adblock Plus list from <path>, can be used multiple times"), QLatin1String("path")));
+	parser.addOption(QCommandLineOption(QLatin1String("iterations"), QLatin1String("Replays corpus <amount> times"), QLatin1String("amount"), QLatin1String("1")));
+	parser.addOption(QCommandLineOption(QLatin1String("keep-cache"), QLatin1String("Keeps results cache between iterations")));
+	parser.addOption(QCommandLineOption(QLatin1String("golden"), QLatin1String("Compares results with file at <path>"), QLatin1String("path")));
+	parser.addOption(QCommandLineOption(QLatin1String("record"), QLatin1String("Writes results to file at <path>"), QLatin1String("path")));
+	parser.process(application);
+
+	const QStringList lists(parser.values(QLatin1String("list")));
+
+	if (parser.positionalArguments().isEmpty() || lists.isEmpty())
+	{
+		parser.showHelp(1);
+	}
+
+	QVector<BenchmarkRequest> requests;
+
+	if (!loadCorpus(parser.positionalArguments().first(), requests))
+	{
+		return 1;
+	}
+
+	QTemporaryDir profileDirectory;
+
+	if (!profileDirectory.isValid() || !QDir(profileDirectory.path()).mkpath(QLatin1String("contentBlocking")))
+	{
+		output << "Failed to create temporary profile directory" << endl;
+
+		return 1;
+	}
+
+	Console::createInstance();
+
+	SettingsManager::createInstance(profileDirectory.path());
+
+	SessionsManager::createInstance(profileDirectory.path(), profileDirectory.path(), true, true);
+
+	ContentBlockingManager::createInstance();
+
+	QVector<ContentBlockingProfile*> profiles;
+	QStringList names;
+	int rulesAmount(0);
+
+	for (int i = 0; i < lists.count(); ++i)
+	{
+		const QString name(QStringLiteral("benchmark%1").arg(i));
+
+		if (!QFile::copy(lists.at(i), profileDirectory.path() + QLatin1String("/contentBlocking/") + name + QLatin1String(".txt")))
+		{
+			output << "Failed to copy list: " << lists.at(i) << endl;
+
+			return 1;
+		}
+
+		rulesAmount += countRules(lists.at(i));
+
+		ContentBlockingProfile *profile(new ContentBlockingProfile(name, QFileInfo(lists.at(i)).fileName(), QUrl(), QDateTime(), QStringList(), 0, ContentBlockingProfile::OtherCategory, ContentBlockingProfile::NoFlags));
+
+		ContentBlockingManager::addProfile(profile);
+
+		profiles.append(profile);
+		names.append(name);
+	}
+
+	const qint64 initialMemoryUsage(getMemoryUsage("VmRSS"));
+	QElapsedTimer timer;
+	timer.start();
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		profiles.at(i)->getStyleSheet();
+	}
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		while (profiles.at(i)->isLoading())
+		{
+			QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+		}
+	}
+
+	const qint64 loadTime(qMax(qint64(1), timer.nsecsElapsed()));
+	const qint64 loadedMemoryUsage(getMemoryUsage("VmRSS"));
+
+	output << "Rules: " << rulesAmount << " loaded in " << (loadTime / 1000000.0) << " ms (" << qRound64(rulesAmount / (loadTime / 1000000000.0)) << " rules/s)" << endl;
+	output << "RSS growth while loading rules: " << formatMemoryUsage((initialMemoryUsage < 0 || loadedMemoryUsage < 0) ? -1 : (loadedMemoryUsage - initialMemoryUsage)) << endl;
+
+	const QVector<int> profileList(ContentBlockingManager::getProfileList(names));
+	const int iterations(qMax(1, parser.value(QLatin1String("iterations")).toInt()));
+	QVector<qint64> latencies;
+	QStringList results;
+
+	latencies.reserve(requests.count() * iterations);
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		if (!parser.isSet(QLatin1String("keep-cache")))
+		{
+			ContentBlockingManager::clearCache();
+		}
+
+		for (int j = 0; j < requests.count(); ++j)
+		{
+			const BenchmarkRequest &request(requests.at(j));
+
+			timer.restart();
+
+			const ContentBlockingManager::CheckResult result(ContentBlockingManager::checkUrl(profileList, request.baseUrl, request.requestUrl, request.resourceType));
+
+			latencies.append(timer.nsecsElapsed());
+
+			if (i == 0)
+			{
+				results.append(formatResult(result) + QLatin1Char('\t') + request.requestUrl.toString());
+			}
+		}
+	}
+
+	output << "Requests: " << requests.count() << " x " << iterations << endl;
+
+	if (!latencies.isEmpty())
+	{
+		std::sort(latencies.begin(), latencies.end());
+
+		const QVector<int> percentiles({50, 90, 99});
+
+		for (int i = 0; i < percentiles.count(); ++i)
+		{
+			output << "p" << percentiles.at(i) << ": " << (latencies.at(qMin(latencies.count() - 1, ((latencies.count() * percentiles.at(i)) / 100))) / 1000.0) << " us" << endl;
+		}
+
+		output << "max: " << (latencies.last() / 1000.0) << " us" << endl;
+	}
+
+	quint64 checkedRequests(0);
+	quint64 hostIndexSettledRequests(0);
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		const ContentBlockingProfile::CheckStatistics statistics(profiles.at(i)->getStatistics());
+
+		checkedRequests += statistics.checkedRequests;
+		hostIndexSettledRequests += statistics.hostIndexSettledRequests;
+	}
+
+	output << "Profile checks settled by host index: " << hostIndexSettledRequests << " of " << checkedRequests;
+
+	if (checkedRequests > 0)
+	{
+		output << " (" << ((hostIndexSettledRequests * 100.0) / checkedRequests) << "%)";
+	}
+
+	output << endl;
+
+	const ContentBlockingManager::CacheStatistics cacheStatistics(ContentBlockingManager::getCacheStatistics());
+
+	output << "Results cache: " << cacheStatistics.hits << " hits, " << cacheStatistics.misses << " misses, " << cacheStatistics.size << " entries";
+
+	if ((cacheStatistics.hits + cacheStatistics.misses) > 0)
+	{
+		output << " (" << ((cacheStatistics.hits * 100.0) / (cacheStatistics.hits + cacheStatistics.misses)) << "% hit rate)";
+	}
+
+	output << endl;
+
+	output << "Peak RSS of the whole process (VmHWM): " << formatMemoryUsage(getMemoryUsage("VmHWM")) << endl;
+
+	if (parser.isSet(QLatin1String("record")))
+	{
+		QFile file(parser.value(QLatin1String("record")));
+
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+		{
+			output << "Failed to write results: " << file.errorString() << endl;
+
+			return 1;
+		}
+
+		QTextStream stream(&file);
+
+		for (int i = 0; i < results.count(); ++i)
+		{
+			stream << results.at(i) << '\n';
+		}
+
+		file.close();
+	}
+
+	if (parser.isSet(QLatin1String("golden")))
+	{
+		QFile file(parser.value(QLatin1String("golden")));
+
+		if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		{
+			output << "Failed to read golden results: " << file.errorString() << endl;
+
+			return 1;
+		}
+
+		const QStringList expectedResults(QString::fromUtf8(file.readAll()).split(QLatin1Char('\n'), QString::SkipEmptyParts));
+		int mismatches(qAbs(expectedResults.count() - results.count()));
+
+		file.close();
+
+		for (int i = 0; i < qMin(expectedResults.count(), results.count()); ++i)
+		{
+			if (expectedResults.at(i) != results.at(i))
+			{
+				output << "- " << expectedResults.at(i) << endl << "+ " << results.at(i) << endl;
+
+				++mismatches;
+			}
+		}
+
+		output << "Mismatches: " << mismatches << endl;
+
+		if (mismatches > 0)
+		{
+			return 2;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,172 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2017 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "../src/core/SettingsManager.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSettings>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTextStream>
+
+#include <algorithm>
+
+using namespace Otter;
+
+QTextStream output(stdout);
+
+QVector<int> globalOptions({SettingsManager::Browser_PrivateModeOption, SettingsManager::Network_WorkOfflineOption, SettingsManager::Interface_EnableSmoothScrollingOption, SettingsManager::Browser_EnableSpellCheckOption, SettingsManager::ContentBlocking_EnableWildcardsOption});
+QVector<int> pageOptions({SettingsManager::Content_DefaultCharacterEncodingOption, SettingsManager::Content_DefaultZoomOption, SettingsManager::Content_UserStyleSheetOption, SettingsManager::ContentBlocking_ProfilesOption, SettingsManager::ContentBlocking_CosmeticFiltersModeOption, SettingsManager::Network_UserAgentOption, SettingsManager::Network_CookiesPolicyOption, SettingsManager::Permissions_EnableJavaScriptOption, SettingsManager::Permissions_EnablePluginsOption, SettingsManager::Permissions_EnableLocalStorageOption, SettingsManager::Security_AllowMixedContentOption});
+QVector<int> requestOptions({SettingsManager::ContentBlocking_EnableContentBlockingOption, SettingsManager::Network_DoNotTrackPolicyOption, SettingsManager::Network_EnableReferrerOption, SettingsManager::Network_ThirdPartyCookiesPolicyOption, SettingsManager::Permissions_EnableImagesOption});
+
+QUrl createUrl(int index, int overridesAmount, int wildcardsAmount)
+{
+	switch (index % 3)
+	{
+		case 0:
+			return QUrl(QStringLiteral("https://host%1.example.com/").arg(index % qMax(1, overridesAmount)));
+		case 1:
+			return QUrl(QStringLiteral("https://www.cdn%1.example.net/").arg(index % qMax(1, wildcardsAmount)));
+		default:
+			return QUrl(QStringLiteral("https://plain%1.example.org/").arg(index));
+	}
+}
+
+void writeOverrides(const QString &path, int overridesAmount, int wildcardsAmount)
+{
+	QSettings settings(path + QLatin1String("/override.ini"), QSettings::IniFormat);
+
+	for (int i = 0; i < overridesAmount; ++i)
+	{
+		settings.beginGroup(QStringLiteral("host%1.example.com").arg(i));
+		settings.setValue(SettingsManager::getOptionName(pageOptions.at(i % pageOptions.count())), QLatin1String("benchmark"));
+		settings.setValue(SettingsManager::getOptionName(requestOptions.at(i % requestOptions.count())), QLatin1String("benchmark"));
+		settings.endGroup();
+	}
+
+	for (int i = 0; i < wildcardsAmount; ++i)
+	{
+		settings.beginGroup(QStringLiteral("*.cdn%1.example.net").arg(i));
+		settings.setValue(SettingsManager::getOptionName(requestOptions.at(i % requestOptions.count())), QLatin1String("benchmark"));
+		settings.endGroup();
+	}
+
+	settings.sync();
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication application(argc, argv);
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QLatin1String("Replays page load style settings lookups and reports their performance"));
+	parser.addHelpOption();
+	parser.addOption(QCommandLineOption(QLatin1String("overrides"), QLatin1String("Creates overrides for <amount> hosts"), QLatin1String("amount"), QLatin1String("1000")));
+	parser.addOption(QCommandLineOption(QLatin1String("wildcards"), QLatin1String("Creates <amount> wildcard overrides"), QLatin1String("amount"), QLatin1String("100")));
+	parser.addOption(QCommandLineOption(QLatin1String("pages"), QLatin1String("Simulates <amount> page loads"), QLatin1String("amount"), QLatin1String("1000")));
+	parser.addOption(QCommandLineOption(QLatin1String("requests"), QLatin1String("Simulates <amount> requests per page load"), QLatin1String("amount"), QLatin1String("50")));
+	parser.process(application);
+
+	QTemporaryDir profileDirectory;
+
+	if (!profileDirectory.isValid())
+	{
+		output << "Failed to create temporary profile directory" << endl;
+
+		return 1;
+	}
+
+	const int overridesAmount(qMax(0, parser.value(QLatin1String("overrides")).toInt()));
+	const int wildcardsAmount(qMax(0, parser.value(QLatin1String("wildcards")).toInt()));
+	const int pagesAmount(qMax(1, parser.value(QLatin1String("pages")).toInt()));
+	const int requestsAmount(qMax(0, parser.value(QLatin1String("requests")).toInt()));
+
+	SettingsManager::createInstance(profileDirectory.path());
+
+	writeOverrides(profileDirectory.path(), overridesAmount, wildcardsAmount);
+
+	SettingsManager::loadOptions();
+
+	QVector<qint64> latencies;
+	latencies.reserve(pagesAmount);
+
+	QElapsedTimer timer;
+	qint64 totalTime(0);
+	quint64 calls(0);
+	int overridenValues(0);
+
+	for (int i = 0; i < pagesAmount; ++i)
+	{
+		const QUrl pageUrl(createUrl(i, overridesAmount, wildcardsAmount));
+
+		timer.start();
+
+		for (int j = 0; j < globalOptions.count(); ++j)
+		{
+			SettingsManager::getOption(globalOptions.at(j));
+		}
+
+		for (int j = 0; j < pageOptions.count(); ++j)
+		{
+			if (SettingsManager::getOption(pageOptions.at(j), pageUrl).toString() == QLatin1String("benchmark"))
+			{
+				++overridenValues;
+			}
+		}
+
+		for (int j = 0; j < requestsAmount; ++j)
+		{
+			const QUrl requestUrl(createUrl((i + j + 1), overridesAmount, wildcardsAmount));
+
+			for (int k = 0; k < requestOptions.count(); ++k)
+			{
+				if (SettingsManager::getOption(requestOptions.at(k), requestUrl).toString() == QLatin1String("benchmark"))
+				{
+					++overridenValues;
+				}
+			}
+		}
+
+		latencies.append(timer.nsecsElapsed());
+
+		totalTime += latencies.last();
+		calls += (globalOptions.count() + pageOptions.count() + (requestsAmount * requestOptions.count()));
+	}
+
+	output << "Overrides: " << overridesAmount << " hosts, " << wildcardsAmount << " wildcards" << endl;
+	output << "Page loads: " << pagesAmount << " x " << requestsAmount << " requests" << endl;
+	output << "Lookups: " << calls << " (" << overridenValues << " overriden) in " << (totalTime / 1000000.0) << " ms (" << (totalTime / qMax(quint64(1), calls)) << " ns per lookup)" << endl;
+
+	std::sort(latencies.begin(), latencies.end());
+
+	const QVector<int> percentiles({50, 90, 99});
+
+	for (int i = 0; i < percentiles.count(); ++i)
+	{
+		output << "p" << percentiles.at(i) << ": " << (latencies.at(qMin(latencies.count() - 1, ((latencies.count() * percentiles.at(i)) / 100))) / 1000.0) << " us per page load" << endl;
+	}
+
+	output << "max: " << (latencies.last() / 1000.0) << " us per page load" << endl;
+
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+	output << endl << SettingsManager::createAccessReport();
+#endif
+
+	return 0;
+}
@@ -27,6 +27,7 @@
 #include "ThemesManager.h"
 #include "Utils.h"
 
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
 #include <QtCore/QFileInfo>
@@ -37,10 +38,14 @@ namespace Otter
 {
 
 AddressCompletionModel::AddressCompletionModel(QObject *parent) : QAbstractListModel(parent),
+	m_localPathsWatcher(nullptr),
 	m_types(UnknownCompletionType),
 	m_updateTimer(0),
 	m_showCompletionCategories(true)
 {
+	m_localPathsThreadPool.setMaxThreadCount(1);
+
+	connect(HistoryManager::getInstance(), SIGNAL(historyLoaded()), this, SLOT(handleHistoryLoaded()));
 }
 
 void AddressCompletionModel::timerEvent(QTimerEvent *event)
@@ -62,8 +67,15 @@ void AddressCompletionModel::timerEvent(QTimerEvent *event)
 
 void AddressCompletionModel::updateModel()
 {
+	if (m_localPathsWatcher)
+	{
+		m_localPathsWatcher->disconnect(this);
+		m_localPathsWatcher->cancel();
+		m_localPathsWatcher->deleteLater();
+		m_localPathsWatcher = nullptr;
+	}
+
 	QVector<CompletionEntry> completions;
-	completions.reserve(10);
 
 	if (m_types.testFlag(SearchSuggestionsCompletionType))
 	{
@@ -103,6 +115,10 @@ void AddressCompletionModel::updateModel()
 		completions.append(completionEntry);
 	}
 
+	setSection(SearchSuggestionsCompletionType, completions);
+
+	completions.clear();
+
 	if (m_types.testFlag(BookmarksCompletionType))
 	{
 		const QVector<BookmarksModel::BookmarkMatch> bookmarks(BookmarksManager::findBookmarks(m_filter));
@@ -126,36 +142,24 @@ void AddressCompletionModel::updateModel()
 		}
 	}
 
-	if (m_types.testFlag(LocalPathSuggestionsCompletionType) && m_filter.contains(QDir::separator()))
-	{
-		const QString directory(m_filter.section(QDir::separator(), 0, -2) + QDir::separator());
-		const QString prefix(m_filter.section(QDir::separator(), -1, -1));
-		const QList<QFileInfo> entries(QDir(Utils::normalizePath(directory)).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot));
-		const QFileIconProvider iconProvider;
-		bool wasAdded(!m_showCompletionCategories);
+	setSection(BookmarksCompletionType, completions);
 
-		for (int i = 0; i < entries.count(); ++i)
-		{
-			if (entries.at(i).fileName().startsWith(prefix, Qt::CaseInsensitive))
-			{
-				const QString path(directory + entries.at(i).fileName());
-				const QMimeType type(QMimeDatabase().mimeTypeForFile(entries.at(i), QMimeDatabase::MatchExtension));
+	completions.clear();
 
-				if (!wasAdded)
-				{
-					completions.append(CompletionEntry(QUrl(), tr("Local files"), QString(), QIcon(), QDateTime(), HeaderType));
+	setSection(LocalPathSuggestionsCompletionType, completions);
 
-					wasAdded = true;
-				}
+	if (m_types.testFlag(LocalPathSuggestionsCompletionType) && m_filter.contains(QDir::separator()))
+	{
+		m_localPathsDirectory = (m_filter.section(QDir::separator(), 0, -2) + QDir::separator());
+		m_localPathsWatcher = new QFutureWatcher<QVector<LocalPathInformation> >(this);
+		m_localPathsWatcher->setFuture(QtConcurrent::run(&m_localPathsThreadPool, &AddressCompletionModel::findLocalPaths, Utils::normalizePath(m_localPathsDirectory), m_filter.section(QDir::separator(), -1, -1)));
 
-				completions.append(CompletionEntry(QUrl::fromLocalFile(QDir::toNativeSeparators(path)), path, path, QIcon::fromTheme(type.iconName(), iconProvider.icon(entries.at(i))), QDateTime(), LocalPathType));
-			}
-		}
+		connect(m_localPathsWatcher, SIGNAL(finished()), this, SLOT(handleLocalPathsFound()));
 	}
 
 	if (m_types.testFlag(HistoryCompletionType))
 	{
-		const QVector<HistoryModel::HistoryEntryMatch> entries(HistoryManager::findEntries(m_filter));
+		const QVector<HistoryModel::HistoryEntryMatch> entries(HistoryManager::findEntries(m_filter, false, HistoryEntriesLimit));
 
 		if (m_showCompletionCategories && !entries.isEmpty())
 		{
@@ -164,13 +168,17 @@ void AddressCompletionModel::updateModel()
 
 		for (int i = 0; i < entries.count(); ++i)
 		{
-			completions.append(CompletionEntry(entries.at(i).entry->data(HistoryModel::UrlRole).toUrl(), entries.at(i).entry->data(HistoryModel::TitleRole).toString(), entries.at(i).match, entries.at(i).entry->data(Qt::DecorationRole).value<QIcon>(), entries.at(i).entry->data(HistoryModel::TimeVisitedRole).toDateTime(), (entries.at(i).isTypedIn ? TypedInHistoryType : HistoryType)));
+			completions.append(CompletionEntry(entries.at(i).entry.url, entries.at(i).entry.title, entries.at(i).match, entries.at(i).entry.icon, entries.at(i).entry.timeVisited, (entries.at(i).isTypedIn ? TypedInHistoryType : HistoryType)));
 		}
 	}
 
+	setSection(HistoryCompletionType, completions);
+
+	completions.clear();
+
 	if (m_types.testFlag(TypedHistoryCompletionType))
 	{
-		const QVector<HistoryModel::HistoryEntryMatch> entries(HistoryManager::findEntries(QString(), true));
+		const QVector<HistoryModel::HistoryEntryMatch> entries(HistoryManager::findEntries(QString(), true, HistoryEntriesLimit));
 
 		if (m_showCompletionCategories && !entries.isEmpty())
 		{
@@ -179,10 +187,14 @@ void AddressCompletionModel::updateModel()
 
 		for (int i = 0; i < entries.count(); ++i)
 		{
-			completions.append(CompletionEntry(entries.at(i).entry->data(HistoryModel::UrlRole).toUrl(), entries.at(i).entry->data(HistoryModel::TitleRole).toString(), entries.at(i).match, entries.at(i).entry->data(Qt::DecorationRole).value<QIcon>(), entries.at(i).entry->data(HistoryModel::TimeVisitedRole).toDateTime(), TypedInHistoryType));
+			completions.append(CompletionEntry(entries.at(i).entry.url, entries.at(i).entry.title, entries.at(i).match, entries.at(i).entry.icon, entries.at(i).entry.timeVisited, TypedInHistoryType));
 		}
 	}
 
+	setSection(TypedHistoryCompletionType, completions);
+
+	completions.clear();
+
 	if (m_types.testFlag(SpecialPagesCompletionType))
 	{
 		const QStringList specialPages(AddonsManager::getSpecialPages());
@@ -206,11 +218,86 @@ void AddressCompletionModel::updateModel()
 		}
 	}
 
-	beginResetModel();
+	setSection(SpecialPagesCompletionType, completions);
+}
+
+void AddressCompletionModel::setSection(CompletionType type, const QVector<CompletionEntry> &completions)
+{
+	const QVector<CompletionType> sections({SearchSuggestionsCompletionType, BookmarksCompletionType, LocalPathSuggestionsCompletionType, HistoryCompletionType, TypedHistoryCompletionType, SpecialPagesCompletionType});
+	const int size(m_sectionSizes.value(type, 0));
+	int offset(0);
+
+	for (int i = 0; i < sections.count() && sections.at(i) != type; ++i)
+	{
+		offset += m_sectionSizes.value(sections.at(i), 0);
+	}
+
+	if (size > 0)
+	{
+		beginRemoveRows(QModelIndex(), offset, (offset + size - 1));
+
+		m_completions.remove(offset, size);
+		m_sectionSizes[type] = 0;
+
+		endRemoveRows();
+	}
+
+	if (!completions.isEmpty())
+	{
+		beginInsertRows(QModelIndex(), offset, (offset + completions.count() - 1));
+
+		for (int i = 0; i < completions.count(); ++i)
+		{
+			m_completions.insert((offset + i), completions.at(i));
+		}
+
+		m_sectionSizes[type] = completions.count();
+
+		endInsertRows();
+	}
+}
+
+void AddressCompletionModel::handleHistoryLoaded()
+{
+	if (m_types.testFlag(TypedHistoryCompletionType))
+	{
+		updateModel();
+	}
+	else if (!m_filter.isEmpty() && m_types.testFlag(HistoryCompletionType) && m_updateTimer == 0)
+	{
+		m_updateTimer = startTimer(50);
+	}
+}
+
+void AddressCompletionModel::handleLocalPathsFound()
+{
+	if (!m_localPathsWatcher || sender() != m_localPathsWatcher)
+	{
+		return;
+	}
+
+	const QVector<LocalPathInformation> localPaths(m_localPathsWatcher->result());
+	const QFileIconProvider iconProvider;
+	QVector<CompletionEntry> completions;
+
+	m_localPathsWatcher->deleteLater();
+	m_localPathsWatcher = nullptr;
+
+	if (m_showCompletionCategories && !localPaths.isEmpty())
+	{
+		completions.append(CompletionEntry(QUrl(), tr("Local files"), QString(), QIcon(), QDateTime(), HeaderType));
+	}
+
+	for (int i = 0; i < localPaths.count(); ++i)
+	{
+		const QString path(m_localPathsDirectory + localPaths.at(i).information.fileName());
+
+		completions.append(CompletionEntry(QUrl::fromLocalFile(QDir::toNativeSeparators(path)), path, path, QIcon::fromTheme(localPaths.at(i).iconName, iconProvider.icon(localPaths.at(i).information)), QDateTime(), LocalPathType));
+	}
 
-	m_completions = completions;
+	setSection(LocalPathSuggestionsCompletionType, completions);
 
-	endResetModel();
+	emit completionReady(m_filter);
 }
 
 void AddressCompletionModel::setFilter(const QString &filter, CompletionTypes types)
@@ -269,11 +356,22 @@ void AddressCompletionModel::setFilter(const QString &filter, CompletionTypes ty
 			m_updateTimer = 0;
 		}
 
-		beginResetModel();
+		if (m_localPathsWatcher)
+		{
+			m_localPathsWatcher->disconnect(this);
+			m_localPathsWatcher->deleteLater();
+			m_localPathsWatcher = nullptr;
+		}
 
-		m_completions.clear();
+		if (!m_completions.isEmpty())
+		{
+			beginRemoveRows(QModelIndex(), 0, (m_completions.count() - 1));
 
-		endResetModel();
+			m_completions.clear();
+			m_sectionSizes.clear();
+
+			endRemoveRows();
+		}
 
 		emit completionReady(QString());
 	}
@@ -283,6 +381,27 @@ void AddressCompletionModel::setFilter(const QString &filter, CompletionTypes ty
 	}
 }
 
+QVector<AddressCompletionModel::LocalPathInformation> AddressCompletionModel::findLocalPaths(const QString &directory, const QString &prefix)
+{
+	const QList<QFileInfo> entries(QDir(directory).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot));
+	const QMimeDatabase mimeDatabase;
+	QVector<LocalPathInformation> localPaths;
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		if (entries.at(i).fileName().startsWith(prefix, Qt::CaseInsensitive))
+		{
+			LocalPathInformation localPath;
+			localPath.information = entries.at(i);
+			localPath.iconName = mimeDatabase.mimeTypeForFile(entries.at(i), QMimeDatabase::MatchExtension).iconName();
+
+			localPaths.append(localPath);
+		}
+	}
+
+	return localPaths;
+}
+
 QVariant AddressCompletionModel::data(const QModelIndex &index, int role) const
 {
 	if (index.column() == 0 && index.row() >= 0 && index.row() < m_completions.count())
@@ -25,6 +25,9 @@
 #include "../core/SearchEnginesManager.h"
 
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QFileInfo>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QThreadPool>
 #include <QtCore/QUrl>
 
 namespace Otter
@@ -103,14 +106,36 @@ public slots:
 	void setFilter(const QString &filter = {}, CompletionTypes types = UnknownCompletionType);
 
 protected:
+	enum EntriesLimit
+	{
+		HistoryEntriesLimit = 50
+	};
+
+	struct LocalPathInformation
+	{
+		QFileInfo information;
+		QString iconName;
+	};
+
 	void timerEvent(QTimerEvent *event) override;
 	void updateModel();
+	void setSection(CompletionType type, const QVector<CompletionEntry> &completions);
+
+	static QVector<LocalPathInformation> findLocalPaths(const QString &directory, const QString &prefix);
+
+protected slots:
+	void handleHistoryLoaded();
+	void handleLocalPathsFound();
 
 private:
+	QFutureWatcher<QVector<LocalPathInformation> > *m_localPathsWatcher;
+	QThreadPool m_localPathsThreadPool;
 	QVector<CompletionEntry> m_completions;
 	QString m_filter;
+	QString m_localPathsDirectory;
 	SearchEnginesManager::SearchEngineDefinition m_defaultSearchEngine;
 	AddressCompletionModel::CompletionTypes m_types;
+	QHash<CompletionType, int> m_sectionSizes;
 	int m_updateTimer;
 	bool m_showCompletionCategories;
 
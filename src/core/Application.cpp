@@ -757,6 +757,10 @@ void Application::handleAboutToQuit()
 {
 	m_isAboutToQuit = true;
 
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+	QTextStream(stderr) << SettingsManager::createAccessReport();
+#endif
+
 	QStringList clearSettings(SettingsManager::getOption(SettingsManager::History_ClearOnCloseOption).toStringList());
 	clearSettings.removeAll(QString());
 
@@ -1230,7 +1234,7 @@ QString Application::createReport(ReportOptions options)
 		stream << QLatin1String("\n\t");
 		stream.setFieldWidth(20);
 		stream << QLatin1String("History");
-		stream << SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.json"));
+		stream << SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.dat"));
 		stream.setFieldWidth(0);
 		stream << QLatin1String("\n\t");
 		stream.setFieldWidth(20);
@@ -1243,6 +1247,9 @@ QString Application::createReport(ReportOptions options)
 	if (options.testFlag(SettingsReport))
 	{
 		stream << SettingsManager::createReport();
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+		stream << SettingsManager::createAccessReport();
+#endif
 	}
 
 	if (options.testFlag(KeyboardShortcutsReport))
@@ -32,7 +32,8 @@ BookmarksModel* BookmarksManager::m_model(nullptr);
 qulonglong BookmarksManager::m_lastUsedFolder(0);
 
 BookmarksManager::BookmarksManager(QObject *parent) : QObject(parent),
-	m_saveTimer(0)
+	m_saveTimer(0),
+	m_visitsSaveTimer(0)
 {
 }
 
@@ -49,6 +50,10 @@ void BookmarksManager::timerEvent(QTimerEvent *event)
 			m_model->save(SessionsManager::getWritableDataPath(QLatin1String("bookmarks.xbel")));
 		}
 	}
+	else if (event->timerId() == m_visitsSaveTimer)
+	{
+		saveVisits();
+	}
 }
 
 void BookmarksManager::createInstance()
@@ -67,6 +72,29 @@ void BookmarksManager::scheduleSave()
 	}
 }
 
+void BookmarksManager::scheduleVisitsSave()
+{
+	if (m_visitsSaveTimer == 0)
+	{
+		m_visitsSaveTimer = startTimer(60000);
+	}
+}
+
+void BookmarksManager::saveVisits()
+{
+	if (m_visitsSaveTimer != 0)
+	{
+		killTimer(m_visitsSaveTimer);
+
+		m_visitsSaveTimer = 0;
+	}
+
+	if (m_model)
+	{
+		m_model->saveVisits(SessionsManager::getWritableDataPath(QLatin1String("bookmarksVisits.dat")));
+	}
+}
+
 void BookmarksManager::updateVisits(const QUrl &url)
 {
 	if (!m_model)
@@ -125,8 +153,11 @@ BookmarksModel* BookmarksManager::getModel()
 	if (!m_model && m_instance)
 	{
 		m_model = new BookmarksModel(SessionsManager::getWritableDataPath(QLatin1String("bookmarks.xbel")), BookmarksModel::BookmarksMode, m_instance);
+		m_model->loadVisits(SessionsManager::getWritableDataPath(QLatin1String("bookmarksVisits.dat")));
 
 		connect(m_model, SIGNAL(modelModified()), m_instance, SLOT(scheduleSave()));
+		connect(m_model, SIGNAL(visitsModified()), m_instance, SLOT(scheduleVisitsSave()));
+		connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), m_instance, SLOT(saveVisits()));
 	}
 
 	return m_model;
@@ -55,9 +55,12 @@ protected:
 
 protected slots:
 	void scheduleSave();
+	void scheduleVisitsSave();
+	void saveVisits();
 
 private:
 	int m_saveTimer;
+	int m_visitsSaveTimer;
 
 	static BookmarksManager *m_instance;
 	static BookmarksModel *m_model;
@@ -25,10 +25,13 @@
 #include "ThemesManager.h"
 #include "Utils.h"
 
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
 #include <QtCore/QFile>
 #include <QtCore/QMimeData>
 #include <QtCore/QSaveFile>
+#include <QtCore/QSet>
 #include <QtWidgets/QMessageBox>
 
 namespace Otter
@@ -236,7 +239,8 @@ bool BookmarksItem::isAncestorOf(BookmarksItem *child) const
 BookmarksModel::BookmarksModel(const QString &path, FormatMode mode, QObject *parent) : QStandardItemModel(parent),
 	m_rootItem(new BookmarksItem()),
 	m_trashItem(new BookmarksItem()),
-	m_mode(mode)
+	m_mode(mode),
+	m_isUpdatingVisits(false)
 {
 	m_rootItem->setData(RootBookmark, TypeRole);
 	m_rootItem->setData(((mode == NotesMode) ? tr("Notes") : tr("Bookmarks")), TitleRole);
@@ -264,7 +268,7 @@ BookmarksModel::BookmarksModel(const QString &path, FormatMode mode, QObject *pa
 		return;
 	}
 
-	QXmlStreamReader reader(file.readAll());
+	QXmlStreamReader reader(&file);
 
 	if (reader.readNextStartElement() && reader.name() == QLatin1String("xbel") && reader.attributes().value(QLatin1String("version")).toString() == QLatin1String("1.0"))
 	{
@@ -292,7 +296,7 @@ BookmarksModel::BookmarksModel(const QString &path, FormatMode mode, QObject *pa
 		}
 	}
 
-	connect(this, SIGNAL(itemChanged(QStandardItem*)), this, SIGNAL(modelModified()));
+	connect(this, SIGNAL(itemChanged(QStandardItem*)), this, SLOT(handleItemChanged()));
 	connect(this, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SIGNAL(modelModified()));
 	connect(this, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(notifyBookmarkModified(QModelIndex)));
 	connect(this, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SIGNAL(modelModified()));
@@ -300,6 +304,11 @@ BookmarksModel::BookmarksModel(const QString &path, FormatMode mode, QObject *pa
 	connect(this, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SIGNAL(modelModified()));
 }
 
+BookmarksModel::~BookmarksModel()
+{
+	m_saveFuture.waitForFinished();
+}
+
 void BookmarksModel::trashBookmark(BookmarksItem *bookmark)
 {
 	if (!bookmark)
@@ -386,10 +395,7 @@ void BookmarksModel::removeBookmark(BookmarksItem *bookmark)
 		m_identifiers.remove(identifier);
 	}
 
-	if (!bookmark->data(KeywordRole).toString().isEmpty() && m_keywords.contains(bookmark->data(KeywordRole).toString()))
-	{
-		m_keywords.remove(bookmark->data(KeywordRole).toString());
-	}
+	removeKeyword(bookmark->data(KeywordRole).toString());
 
 	emit bookmarkRemoved(bookmark, static_cast<BookmarksItem*>(bookmark->parent()));
 
@@ -398,6 +404,80 @@ void BookmarksModel::removeBookmark(BookmarksItem *bookmark)
 	emit modelModified();
 }
 
+void BookmarksModel::loadVisits(const QString &path)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_4);
+
+	quint32 amount(0);
+
+	stream >> amount;
+
+	for (quint32 i = 0; i < amount; ++i)
+	{
+		quint64 identifier(0);
+		qint32 visits(0);
+		QDateTime timeVisited;
+
+		stream >> identifier >> visits >> timeVisited;
+
+		if (stream.status() != QDataStream::Ok)
+		{
+			break;
+		}
+
+		BookmarksItem *bookmark(getBookmark(identifier));
+
+		if (!bookmark)
+		{
+			continue;
+		}
+
+		m_isUpdatingVisits = true;
+
+		if (visits > bookmark->rawData(VisitsRole).toInt())
+		{
+			bookmark->setItemData(visits, VisitsRole);
+		}
+
+		if (timeVisited.isValid() && timeVisited > bookmark->rawData(TimeVisitedRole).toDateTime())
+		{
+			bookmark->setItemData(timeVisited, TimeVisitedRole);
+		}
+
+		m_isUpdatingVisits = false;
+	}
+}
+
+void BookmarksModel::save(const QString &path)
+{
+	if (SessionsManager::isReadOnly())
+	{
+		return;
+	}
+
+	QVector<BookmarkSnapshot> bookmarks;
+	bookmarks.reserve(m_identifiers.count() + 1);
+
+	createSnapshot(m_rootItem, &bookmarks);
+
+	m_saveFuture.waitForFinished();
+	m_saveFuture = QtConcurrent::run(&BookmarksModel::writeBookmarks, bookmarks, path, m_mode);
+	m_savePath = path;
+
+	QFutureWatcher<QString> *watcher(new QFutureWatcher<QString>(this));
+	watcher->setFuture(m_saveFuture);
+
+	connect(watcher, SIGNAL(finished()), this, SLOT(handleBookmarksSaved()));
+}
+
 void BookmarksModel::readBookmark(QXmlStreamReader *reader, BookmarksItem *parent)
 {
 	BookmarksItem *bookmark(nullptr);
@@ -561,49 +641,71 @@ void BookmarksModel::readBookmark(QXmlStreamReader *reader, BookmarksItem *paren
 	}
 }
 
-void BookmarksModel::writeBookmark(QXmlStreamWriter *writer, BookmarksItem *bookmark) const
+void BookmarksModel::createSnapshot(BookmarksItem *bookmark, QVector<BookmarkSnapshot> *bookmarks) const
 {
-	if (!bookmark)
+	BookmarkSnapshot snapshot;
+	snapshot.title = bookmark->rawData(TitleRole).toString();
+	snapshot.description = bookmark->rawData(DescriptionRole).toString();
+	snapshot.keyword = bookmark->rawData(KeywordRole).toString();
+	snapshot.url = bookmark->rawData(UrlRole).toString();
+	snapshot.timeAdded = bookmark->rawData(TimeAddedRole).toDateTime();
+	snapshot.timeModified = bookmark->rawData(TimeModifiedRole).toDateTime();
+	snapshot.timeVisited = bookmark->rawData(TimeVisitedRole).toDateTime();
+	snapshot.identifier = bookmark->rawData(IdentifierRole).toULongLong();
+	snapshot.type = static_cast<BookmarkType>(bookmark->rawData(TypeRole).toInt());
+	snapshot.visits = bookmark->rawData(VisitsRole).toInt();
+	snapshot.children = bookmark->rowCount();
+
+	bookmarks->append(snapshot);
+
+	for (int i = 0; i < bookmark->rowCount(); ++i)
 	{
-		return;
+		createSnapshot(static_cast<BookmarksItem*>(bookmark->child(i, 0)), bookmarks);
 	}
+}
+
+int BookmarksModel::writeBookmark(QXmlStreamWriter *writer, const QVector<BookmarkSnapshot> &bookmarks, int index, FormatMode mode)
+{
+	const BookmarkSnapshot &bookmark(bookmarks.at(index));
+
+	++index;
 
-	switch (static_cast<BookmarkType>(bookmark->data(TypeRole).toInt()))
+	switch (bookmark.type)
 	{
 		case FolderBookmark:
 			writer->writeStartElement(QLatin1String("folder"));
-			writer->writeAttribute(QLatin1String("id"), QString::number(bookmark->rawData(IdentifierRole).toULongLong()));
+			writer->writeAttribute(QLatin1String("id"), QString::number(bookmark.identifier));
 
-			if (bookmark->rawData(TimeAddedRole).toDateTime().isValid())
+			if (bookmark.timeAdded.isValid())
 			{
-				writer->writeAttribute(QLatin1String("added"), bookmark->rawData(TimeAddedRole).toDateTime().toString(Qt::ISODate));
+				writer->writeAttribute(QLatin1String("added"), bookmark.timeAdded.toString(Qt::ISODate));
 			}
 
-			if (bookmark->rawData(TimeModifiedRole).toDateTime().isValid())
+			if (bookmark.timeModified.isValid())
 			{
-				writer->writeAttribute(QLatin1String("modified"), bookmark->rawData(TimeModifiedRole).toDateTime().toString(Qt::ISODate));
+				writer->writeAttribute(QLatin1String("modified"), bookmark.timeModified.toString(Qt::ISODate));
 			}
 
-			writer->writeTextElement(QLatin1String("title"), bookmark->rawData(TitleRole).toString());
+			writer->writeTextElement(QLatin1String("title"), bookmark.title);
 
-			if (!bookmark->rawData(DescriptionRole).toString().isEmpty())
+			if (!bookmark.description.isEmpty())
 			{
-				writer->writeTextElement(QLatin1String("desc"), bookmark->rawData(DescriptionRole).toString());
+				writer->writeTextElement(QLatin1String("desc"), bookmark.description);
 			}
 
-			if (m_mode == BookmarksMode && !bookmark->rawData(KeywordRole).toString().isEmpty())
+			if (mode == BookmarksMode && !bookmark.keyword.isEmpty())
 			{
 				writer->writeStartElement(QLatin1String("info"));
 				writer->writeStartElement(QLatin1String("metadata"));
 				writer->writeAttribute(QLatin1String("owner"), QLatin1String("http://otter-browser.org/otter-xbel-bookmark"));
-				writer->writeTextElement(QLatin1String("keyword"), bookmark->rawData(KeywordRole).toString());
+				writer->writeTextElement(QLatin1String("keyword"), bookmark.keyword);
 				writer->writeEndElement();
 				writer->writeEndElement();
 			}
 
-			for (int i = 0; i < bookmark->rowCount(); ++i)
+			for (int i = 0; i < bookmark.children; ++i)
 			{
-				writeBookmark(writer, static_cast<BookmarksItem*>(bookmark->child(i, 0)));
+				index = writeBookmark(writer, bookmarks, index, mode);
 			}
 
 			writer->writeEndElement();
@@ -611,52 +713,52 @@ void BookmarksModel::writeBookmark(QXmlStreamWriter *writer, BookmarksItem *book
 			break;
 		case UrlBookmark:
 			writer->writeStartElement(QLatin1String("bookmark"));
-			writer->writeAttribute(QLatin1String("id"), QString::number(bookmark->rawData(IdentifierRole).toULongLong()));
+			writer->writeAttribute(QLatin1String("id"), QString::number(bookmark.identifier));
 
-			if (!bookmark->rawData(UrlRole).toString().isEmpty())
+			if (!bookmark.url.isEmpty())
 			{
-				writer->writeAttribute(QLatin1String("href"), bookmark->rawData(UrlRole).toString());
+				writer->writeAttribute(QLatin1String("href"), bookmark.url);
 			}
 
-			if (bookmark->rawData(TimeAddedRole).toDateTime().isValid())
+			if (bookmark.timeAdded.isValid())
 			{
-				writer->writeAttribute(QLatin1String("added"), bookmark->rawData(TimeAddedRole).toDateTime().toString(Qt::ISODate));
+				writer->writeAttribute(QLatin1String("added"), bookmark.timeAdded.toString(Qt::ISODate));
 			}
 
-			if (bookmark->rawData(TimeModifiedRole).toDateTime().isValid())
+			if (bookmark.timeModified.isValid())
 			{
-				writer->writeAttribute(QLatin1String("modified"), bookmark->rawData(TimeModifiedRole).toDateTime().toString(Qt::ISODate));
+				writer->writeAttribute(QLatin1String("modified"), bookmark.timeModified.toString(Qt::ISODate));
 			}
 
-			if (m_mode != NotesMode)
+			if (mode != NotesMode)
 			{
-				if (bookmark->rawData(TimeVisitedRole).toDateTime().isValid())
+				if (bookmark.timeVisited.isValid())
 				{
-					writer->writeAttribute(QLatin1String("visited"), bookmark->rawData(TimeVisitedRole).toDateTime().toString(Qt::ISODate));
+					writer->writeAttribute(QLatin1String("visited"), bookmark.timeVisited.toString(Qt::ISODate));
 				}
 
-				writer->writeTextElement(QLatin1String("title"), bookmark->rawData(TitleRole).toString());
+				writer->writeTextElement(QLatin1String("title"), bookmark.title);
 			}
 
-			if (!bookmark->rawData(DescriptionRole).toString().isEmpty())
+			if (!bookmark.description.isEmpty())
 			{
-				writer->writeTextElement(QLatin1String("desc"), bookmark->rawData(DescriptionRole).toString());
+				writer->writeTextElement(QLatin1String("desc"), bookmark.description);
 			}
 
-			if (m_mode == BookmarksMode && (!bookmark->rawData(KeywordRole).toString().isEmpty() || bookmark->rawData(VisitsRole).toInt() > 0))
+			if (mode == BookmarksMode && (!bookmark.keyword.isEmpty() || bookmark.visits > 0))
 			{
 				writer->writeStartElement(QLatin1String("info"));
 				writer->writeStartElement(QLatin1String("metadata"));
 				writer->writeAttribute(QLatin1String("owner"), QLatin1String("http://otter-browser.org/otter-xbel-bookmark"));
 
-				if (!bookmark->rawData(KeywordRole).toString().isEmpty())
+				if (!bookmark.keyword.isEmpty())
 				{
-					writer->writeTextElement(QLatin1String("keyword"), bookmark->rawData(KeywordRole).toString());
+					writer->writeTextElement(QLatin1String("keyword"), bookmark.keyword);
 				}
 
-				if (bookmark->rawData(VisitsRole).toInt() > 0)
+				if (bookmark.visits > 0)
 				{
-					writer->writeTextElement(QLatin1String("visits"), QString::number(bookmark->rawData(VisitsRole).toInt()));
+					writer->writeTextElement(QLatin1String("visits"), QString::number(bookmark.visits));
 				}
 
 				writer->writeEndElement();
@@ -671,6 +773,8 @@ void BookmarksModel::writeBookmark(QXmlStreamWriter *writer, BookmarksItem *book
 
 			break;
 	}
+
+	return index;
 }
 
 void BookmarksModel::removeBookmarkUrl(BookmarksItem *bookmark)
@@ -684,17 +788,7 @@ void BookmarksModel::removeBookmarkUrl(BookmarksItem *bookmark)
 
 	if (type == UrlBookmark)
 	{
-		const QUrl url(Utils::normalizeUrl(bookmark->data(UrlRole).toUrl()));
-
-		if (!url.isEmpty() && m_urls.contains(url))
-		{
-			m_urls[url].removeAll(bookmark);
-
-			if (m_urls[url].isEmpty())
-			{
-				m_urls.remove(url);
-			}
-		}
+		removeUrl(Utils::normalizeUrl(bookmark->data(UrlRole).toUrl()), bookmark);
 	}
 	else if (type == FolderBookmark)
 	{
@@ -716,17 +810,7 @@ void BookmarksModel::readdBookmarkUrl(BookmarksItem *bookmark)
 
 	if (type == UrlBookmark)
 	{
-		const QUrl url(Utils::normalizeUrl(bookmark->data(UrlRole).toUrl()));
-
-		if (!url.isEmpty())
-		{
-			if (!m_urls.contains(url))
-			{
-				m_urls[url] = QVector<BookmarksItem*>();
-			}
-
-			m_urls[url].append(bookmark);
-		}
+		addUrl(Utils::normalizeUrl(bookmark->data(UrlRole).toUrl()), bookmark);
 	}
 	else if (type == FolderBookmark)
 	{
@@ -737,6 +821,74 @@ void BookmarksModel::readdBookmarkUrl(BookmarksItem *bookmark)
 	}
 }
 
+void BookmarksModel::addUrl(const QUrl &url, BookmarksItem *bookmark)
+{
+	if (url.isEmpty())
+	{
+		return;
+	}
+
+	if (!m_urls.contains(url))
+	{
+		const QStringList keys(Utils::createUrlMatchKeys(url));
+
+		for (int i = 0; i < keys.count(); ++i)
+		{
+			m_urlsIndex.insert(keys.at(i), url);
+		}
+	}
+
+	m_urls[url].append(bookmark);
+}
+
+void BookmarksModel::removeUrl(const QUrl &url, BookmarksItem *bookmark)
+{
+	if (url.isEmpty() || !m_urls.contains(url))
+	{
+		return;
+	}
+
+	m_urls[url].removeAll(bookmark);
+
+	if (m_urls[url].isEmpty())
+	{
+		const QStringList keys(Utils::createUrlMatchKeys(url));
+
+		for (int i = 0; i < keys.count(); ++i)
+		{
+			m_urlsIndex.remove(keys.at(i), url);
+		}
+
+		m_urls.remove(url);
+	}
+}
+
+void BookmarksModel::addKeyword(const QString &keyword, BookmarksItem *bookmark)
+{
+	if (keyword.isEmpty())
+	{
+		return;
+	}
+
+	if (!m_keywords.contains(keyword))
+	{
+		m_keywordsIndex.insert(keyword.toLower(), keyword);
+	}
+
+	m_keywords[keyword] = bookmark;
+}
+
+void BookmarksModel::removeKeyword(const QString &keyword)
+{
+	if (keyword.isEmpty() || !m_keywords.contains(keyword))
+	{
+		return;
+	}
+
+	m_keywordsIndex.remove(keyword.toLower(), keyword);
+	m_keywords.remove(keyword);
+}
+
 void BookmarksModel::emptyTrash()
 {
 	BookmarksItem *trashItem(getTrashItem());
@@ -748,6 +900,33 @@ void BookmarksModel::emptyTrash()
 	emit modelModified();
 }
 
+void BookmarksModel::handleItemChanged()
+{
+	if (!m_isUpdatingVisits)
+	{
+		emit modelModified();
+	}
+}
+
+void BookmarksModel::handleBookmarksSaved()
+{
+	QFutureWatcher<QString> *watcher(static_cast<QFutureWatcher<QString>*>(sender()));
+
+	if (!watcher)
+	{
+		return;
+	}
+
+	const QString errorString(watcher->result());
+
+	if (!errorString.isEmpty())
+	{
+		Console::addMessage(((m_mode == NotesMode) ? tr("Failed to save notes file: %1") : tr("Failed to save bookmarks file: %1")).arg(errorString), Console::OtherCategory, Console::ErrorLevel, m_savePath);
+	}
+
+	watcher->deleteLater();
+}
+
 void BookmarksModel::notifyBookmarkModified(const QModelIndex &index)
 {
 	BookmarksItem *bookmark(getBookmark(index));
@@ -921,65 +1100,71 @@ QStringList BookmarksModel::getKeywords() const
 
 QVector<BookmarksModel::BookmarkMatch> BookmarksModel::findBookmarks(const QString &prefix) const
 {
-	QVector<BookmarksItem*> matchedBookmarks;
-	QVector<BookmarksModel::BookmarkMatch> allMatches;
-	QVector<BookmarksModel::BookmarkMatch> currentMatches;
-	QMultiMap<QDateTime, BookmarksModel::BookmarkMatch> matchesMap;
-	QHash<QString, BookmarksItem*>::const_iterator keywordsIterator;
+	const QString key(prefix.toLower());
+	QSet<BookmarksItem*> matchedBookmarks;
+	QVector<QPair<QDateTime, BookmarkMatch> > keywordMatches;
+	QVector<QPair<QDateTime, BookmarkMatch> > urlMatches;
+	QMultiMap<QString, QString>::const_iterator keywordsIterator;
 
-	for (keywordsIterator = m_keywords.constBegin(); keywordsIterator != m_keywords.constEnd(); ++keywordsIterator)
+	for (keywordsIterator = m_keywordsIndex.lowerBound(key); (keywordsIterator != m_keywordsIndex.constEnd() && keywordsIterator.key().startsWith(key)); ++keywordsIterator)
 	{
-		if (keywordsIterator.key().startsWith(prefix, Qt::CaseInsensitive))
-		{
-			BookmarksModel::BookmarkMatch match;
-			match.bookmark = keywordsIterator.value();
-			match.match = keywordsIterator.key();
+		BookmarkMatch match;
+		match.bookmark = m_keywords.value(keywordsIterator.value());
+		match.match = keywordsIterator.value();
 
-			matchesMap.insert(match.bookmark->data(TimeVisitedRole).toDateTime(), match);
+		if (match.bookmark && !matchedBookmarks.contains(match.bookmark))
+		{
+			keywordMatches.append(qMakePair(match.bookmark->data(TimeVisitedRole).toDateTime(), match));
 
-			matchedBookmarks.append(match.bookmark);
+			matchedBookmarks.insert(match.bookmark);
 		}
 	}
 
-	currentMatches = matchesMap.values().toVector();
+	QMultiMap<QString, QUrl>::const_iterator urlsIterator;
 
-	matchesMap.clear();
-
-	for (int i = (currentMatches.count() - 1); i >= 0; --i)
+	for (urlsIterator = m_urlsIndex.lowerBound(key); (urlsIterator != m_urlsIndex.constEnd() && urlsIterator.key().startsWith(key)); ++urlsIterator)
 	{
-		allMatches.append(currentMatches.at(i));
-	}
+		const QVector<BookmarksItem*> bookmarks(m_urls.value(urlsIterator.value()));
 
-	QHash<QUrl, QVector<BookmarksItem*> >::const_iterator urlsIterator;
-
-	for (urlsIterator = m_urls.constBegin(); urlsIterator != m_urls.constEnd(); ++urlsIterator)
-	{
-		if (urlsIterator.value().isEmpty() || matchedBookmarks.contains(urlsIterator.value().first()))
+		if (bookmarks.isEmpty() || matchedBookmarks.contains(bookmarks.first()))
 		{
 			continue;
 		}
 
-		const QString result(Utils::matchUrl(urlsIterator.key(), prefix));
+		const QString result(Utils::matchUrl(urlsIterator.value(), prefix));
 
 		if (!result.isEmpty())
 		{
 			BookmarkMatch match;
-			match.bookmark = urlsIterator.value().first();
+			match.bookmark = bookmarks.first();
 			match.match = result;
 
-			matchesMap.insert(match.bookmark->data(TimeVisitedRole).toDateTime(), match);
+			urlMatches.append(qMakePair(match.bookmark->data(TimeVisitedRole).toDateTime(), match));
 
-			matchedBookmarks.append(match.bookmark);
+			matchedBookmarks.insert(match.bookmark);
 		}
 	}
 
-	currentMatches = matchesMap.values().toVector();
+	std::stable_sort(keywordMatches.begin(), keywordMatches.end(), [&](const QPair<QDateTime, BookmarkMatch> &first, const QPair<QDateTime, BookmarkMatch> &second)
+	{
+		return (first.first > second.first);
+	});
+	std::stable_sort(urlMatches.begin(), urlMatches.end(), [&](const QPair<QDateTime, BookmarkMatch> &first, const QPair<QDateTime, BookmarkMatch> &second)
+	{
+		return (first.first > second.first);
+	});
+
+	QVector<BookmarksModel::BookmarkMatch> allMatches;
+	allMatches.reserve(keywordMatches.count() + urlMatches.count());
 
-	matchesMap.clear();
+	for (int i = 0; i < keywordMatches.count(); ++i)
+	{
+		allMatches.append(keywordMatches.at(i).second);
+	}
 
-	for (int i = (currentMatches.count() - 1); i >= 0; --i)
+	for (int i = 0; i < urlMatches.count(); ++i)
 	{
-		allMatches.append(currentMatches.at(i));
+		allMatches.append(urlMatches.at(i).second);
 	}
 
 	return allMatches;
@@ -992,28 +1177,21 @@ QVector<BookmarksItem *> BookmarksModel::findUrls(const QUrl &url, QStandardItem
 		branch = item(0, 0);
 	}
 
+	const QVector<BookmarksItem*> bookmarks(m_urls.value(url));
 	QVector<BookmarksItem*> items;
 
-	for (int i = 0; i < branch->rowCount(); ++i)
+	for (int i = 0; i < bookmarks.count(); ++i)
 	{
-		BookmarksItem *item(static_cast<BookmarksItem*>(branch->child(i)));
+		QStandardItem *parent(bookmarks.at(i)->parent());
 
-		if (item)
+		while (parent && parent != branch)
 		{
-			const BookmarkType type(static_cast<BookmarkType>(item->data(TypeRole).toInt()));
+			parent = parent->parent();
+		}
 
-			if (type == FolderBookmark)
-			{
-#if QT_VERSION >= 0x050500
-				items.append(findUrls(url, item));
-#else
-				items += findUrls(url, item);
-#endif
-			}
-			else if (type == UrlBookmark && url == Utils::normalizeUrl(item->data(UrlRole).toUrl()))
-			{
-				items.append(item);
-			}
+		if (parent)
+		{
+			items.append(bookmarks.at(i));
 		}
 	}
 
@@ -1135,18 +1313,13 @@ bool BookmarksModel::dropMimeData(const QMimeData *data, Qt::DropAction action,
 	return false;
 }
 
-bool BookmarksModel::save(const QString &path) const
+QString BookmarksModel::writeBookmarks(const QVector<BookmarkSnapshot> &bookmarks, const QString &path, FormatMode mode)
 {
-	if (SessionsManager::isReadOnly())
-	{
-		return false;
-	}
-
 	QSaveFile file(path);
 
 	if (!file.open(QIODevice::WriteOnly))
 	{
-		return false;
+		return file.errorString();
 	}
 
 	QXmlStreamWriter writer(&file);
@@ -1157,15 +1330,57 @@ bool BookmarksModel::save(const QString &path) const
 	writer.writeStartElement(QLatin1String("xbel"));
 	writer.writeAttribute(QLatin1String("version"), QLatin1String("1.0"));
 
-	QStandardItem *rootItem(item(0, 0));
+	int index(1);
 
-	for (int i = 0; i < rootItem->rowCount(); ++i)
+	for (int i = 0; i < bookmarks.value(0).children; ++i)
 	{
-		writeBookmark(&writer, static_cast<BookmarksItem*>(rootItem->child(i, 0)));
+		index = writeBookmark(&writer, bookmarks, index, mode);
 	}
 
 	writer.writeEndDocument();
 
+	if (!file.commit())
+	{
+		return file.errorString();
+	}
+
+	return QString();
+}
+
+bool BookmarksModel::saveVisits(const QString &path) const
+{
+	if (SessionsManager::isReadOnly() || m_mode != BookmarksMode)
+	{
+		return false;
+	}
+
+	QVector<BookmarksItem*> bookmarks;
+	QMap<quint64, BookmarksItem*>::const_iterator iterator;
+
+	for (iterator = m_identifiers.constBegin(); iterator != m_identifiers.constEnd(); ++iterator)
+	{
+		if (iterator.value()->rawData(VisitsRole).toInt() > 0 || iterator.value()->rawData(TimeVisitedRole).toDateTime().isValid())
+		{
+			bookmarks.append(iterator.value());
+		}
+	}
+
+	QSaveFile file(path);
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_4);
+	stream << static_cast<quint32>(bookmarks.count());
+
+	for (int i = 0; i < bookmarks.count(); ++i)
+	{
+		stream << bookmarks.at(i)->rawData(IdentifierRole).toULongLong() << static_cast<qint32>(bookmarks.at(i)->rawData(VisitsRole).toInt()) << bookmarks.at(i)->rawData(TimeVisitedRole).toDateTime();
+	}
+
 	return file.commit();
 }
 
@@ -1183,40 +1398,13 @@ bool BookmarksModel::setData(const QModelIndex &index, const QVariant &value, in
 		const QUrl oldUrl(Utils::normalizeUrl(index.data(UrlRole).toUrl()));
 		const QUrl newUrl(Utils::normalizeUrl(value.toUrl()));
 
-		if (!oldUrl.isEmpty() && m_urls.contains(oldUrl))
-		{
-			m_urls[oldUrl].removeAll(bookmark);
-
-			if (m_urls[oldUrl].isEmpty())
-			{
-				m_urls.remove(oldUrl);
-			}
-		}
-
-		if (!newUrl.isEmpty())
-		{
-			if (!m_urls.contains(newUrl))
-			{
-				m_urls[newUrl] = QVector<BookmarksItem*>();
-			}
-
-			m_urls[newUrl].append(bookmark);
-		}
+		removeUrl(oldUrl, bookmark);
+		addUrl(newUrl, bookmark);
 	}
 	else if (role == KeywordRole && value.toString() != index.data(KeywordRole).toString())
 	{
-		const QString oldKeyword(index.data(KeywordRole).toString());
-		const QString newKeyword(value.toString());
-
-		if (!oldKeyword.isEmpty() && m_keywords.contains(oldKeyword))
-		{
-			m_keywords.remove(oldKeyword);
-		}
-
-		if (!newKeyword.isEmpty())
-		{
-			m_keywords[newKeyword] = bookmark;
-		}
+		removeKeyword(index.data(KeywordRole).toString());
+		addKeyword(value.toString(), bookmark);
 	}
 	else if (m_mode == NotesMode && role == DescriptionRole)
 	{
@@ -1225,6 +1413,20 @@ bool BookmarksModel::setData(const QModelIndex &index, const QVariant &value, in
 		setData(index, ((title == value.toString().trimmed()) ? title : title + QStringLiteral("…")), TitleRole);
 	}
 
+	if (m_mode == BookmarksMode && (role == VisitsRole || role == TimeVisitedRole))
+	{
+		m_isUpdatingVisits = true;
+
+		bookmark->setItemData(value, role);
+
+		m_isUpdatingVisits = false;
+
+		emit bookmarkModified(bookmark);
+		emit visitsModified();
+
+		return true;
+	}
+
 	bookmark->setItemData(value, role);
 
 	switch (role)
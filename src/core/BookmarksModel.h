@@ -21,6 +21,8 @@
 #ifndef OTTER_BOOKMARKSMODEL_H
 #define OTTER_BOOKMARKSMODEL_H
 
+#include <QtCore/QDateTime>
+#include <QtCore/QFutureWatcher>
 #include <QtCore/QUrl>
 #include <QtCore/QXmlStreamReader>
 #include <QtCore/QXmlStreamWriter>
@@ -91,10 +93,13 @@ public:
 	};
 
 	explicit BookmarksModel(const QString &path, FormatMode mode, QObject *parent = nullptr);
+	~BookmarksModel();
 
 	void trashBookmark(BookmarksItem *bookmark);
 	void restoreBookmark(BookmarksItem *bookmark);
 	void removeBookmark(BookmarksItem *bookmark);
+	void loadVisits(const QString &path);
+	void save(const QString &path);
 	BookmarksItem* addBookmark(BookmarkType type, quint64 identifier = 0, const QUrl &url = {}, const QString &title = {}, BookmarksItem *parent = nullptr, int index = -1);
 	BookmarksItem* getBookmark(const QString &keyword) const;
 	BookmarksItem* getBookmark(const QModelIndex &index) const;
@@ -112,7 +117,7 @@ public:
 	bool moveBookmark(BookmarksItem *bookmark, BookmarksItem *newParent, int newRow = -1);
 	bool canDropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent) const override;
 	bool dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent) override;
-	bool save(const QString &path) const;
+	bool saveVisits(const QString &path) const;
 	bool setData(const QModelIndex &index, const QVariant &value, int role) override;
 	bool hasBookmark(const QUrl &url) const;
 	bool hasKeyword(const QString &keyword) const;
@@ -121,12 +126,36 @@ public slots:
 	void emptyTrash();
 
 protected:
+	struct BookmarkSnapshot
+	{
+		QString title;
+		QString description;
+		QString keyword;
+		QString url;
+		QDateTime timeAdded;
+		QDateTime timeModified;
+		QDateTime timeVisited;
+		quint64 identifier = 0;
+		BookmarkType type = UnknownBookmark;
+		int visits = 0;
+		int children = 0;
+	};
+
 	void readBookmark(QXmlStreamReader *reader, BookmarksItem *parent);
-	void writeBookmark(QXmlStreamWriter *writer, BookmarksItem *bookmark) const;
+	void createSnapshot(BookmarksItem *bookmark, QVector<BookmarkSnapshot> *bookmarks) const;
 	void removeBookmarkUrl(BookmarksItem *bookmark);
 	void readdBookmarkUrl(BookmarksItem *bookmark);
+	void addUrl(const QUrl &url, BookmarksItem *bookmark);
+	void removeUrl(const QUrl &url, BookmarksItem *bookmark);
+	void addKeyword(const QString &keyword, BookmarksItem *bookmark);
+	void removeKeyword(const QString &keyword);
+
+	static int writeBookmark(QXmlStreamWriter *writer, const QVector<BookmarkSnapshot> &bookmarks, int index, FormatMode mode);
+	static QString writeBookmarks(const QVector<BookmarkSnapshot> &bookmarks, const QString &path, FormatMode mode);
 
 protected slots:
+	void handleItemChanged();
+	void handleBookmarksSaved();
 	void notifyBookmarkModified(const QModelIndex &index);
 
 private:
@@ -135,8 +164,13 @@ private:
 	QHash<BookmarksItem*, QPair<QModelIndex, int> > m_trash;
 	QHash<QUrl, QVector<BookmarksItem*> > m_urls;
 	QHash<QString, BookmarksItem*> m_keywords;
+	QMultiMap<QString, QUrl> m_urlsIndex;
+	QMultiMap<QString, QString> m_keywordsIndex;
 	QMap<quint64, BookmarksItem*> m_identifiers;
+	QString m_savePath;
+	QFuture<QString> m_saveFuture;
 	FormatMode m_mode;
+	bool m_isUpdatingVisits;
 
 signals:
 	void bookmarkAdded(BookmarksItem *bookmark);
@@ -146,6 +180,7 @@ signals:
 	void bookmarkRestored(BookmarksItem *bookmark);
 	void bookmarkRemoved(BookmarksItem *bookmark, BookmarksItem *previousParent);
 	void modelModified();
+	void visitsModified();
 
 friend class BookmarksItem;
 };
@@ -20,14 +20,21 @@
 #include "Console.h"
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QTimerEvent>
 
 namespace Otter
 {
 
 Console* Console::m_instance(nullptr);
+Console::QueueSlot* Console::m_queue(nullptr);
 QVector<Console::Message> Console::m_messages;
+QAtomicInteger<quint32> Console::m_queueWritePosition(0);
+QAtomicInteger<quint32> Console::m_droppedMessages(0);
+QAtomicInt Console::m_isDeliveryScheduled(0);
+quint32 Console::m_queueReadPosition(0);
 
-Console::Console(QObject *parent) : QObject(parent)
+Console::Console(QObject *parent) : QObject(parent),
+	m_deliveryTimer(0)
 {
 }
 
@@ -35,29 +42,138 @@ void Console::createInstance()
 {
 	if (!m_instance)
 	{
+		m_queue = new QueueSlot[QueueSize];
+
+		for (int i = 0; i < QueueSize; ++i)
+		{
+			m_queue[i].sequence.store(i);
+		}
+
 		m_instance = new Console(QCoreApplication::instance());
 	}
 }
 
+void Console::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() != m_deliveryTimer)
+	{
+		return;
+	}
+
+	killTimer(m_deliveryTimer);
+
+	m_deliveryTimer = 0;
+
+	m_isDeliveryScheduled.storeRelease(0);
+
+	QVector<Message> messages;
+
+	while (true)
+	{
+		QueueSlot &slot(m_queue[m_queueReadPosition % QueueSize]);
+
+		if (slot.sequence.loadAcquire() != (m_queueReadPosition + 1))
+		{
+			break;
+		}
+
+		messages.append(slot.message);
+
+		slot.message = Message();
+		slot.sequence.storeRelease(m_queueReadPosition + QueueSize);
+
+		++m_queueReadPosition;
+	}
+
+	const quint32 droppedMessages(m_droppedMessages.fetchAndStoreRelaxed(0));
+
+	if (droppedMessages > 0)
+	{
+		Message message;
+		message.time = QDateTime::currentDateTime();
+		message.note = tr("%n message(s) dropped", "", droppedMessages);
+		message.category = OtherCategory;
+		message.level = WarningLevel;
+
+		messages.append(message);
+	}
+
+	if (messages.isEmpty())
+	{
+		return;
+	}
+
+	m_messages += messages;
+
+	if (m_messages.count() > MessagesLimit)
+	{
+		m_messages.remove(0, (m_messages.count() - MessagesLimit));
+	}
+
+	emit messagesAdded(messages);
+}
+
 void Console::addMessage(const QString &note, MessageCategory category, MessageLevel level, const QString &source, int line, quint64 window)
 {
-	Message message;
-	message.time = QDateTime::currentDateTime();
-	message.note = note;
-	message.source = source;
-	message.category = category;
-	message.level = level;
-	message.line = line;
-	message.window = window;
-
-	m_messages.append(message);
-
-	if (m_messages.count() > 1000)
+	if (!m_instance)
 	{
-		m_messages.removeFirst();
+		return;
 	}
 
-	emit m_instance->messageAdded(message);
+	quint32 position(m_queueWritePosition.loadAcquire());
+	QueueSlot *slot(nullptr);
+
+	while (true)
+	{
+		slot = &m_queue[position % QueueSize];
+
+		const qint32 difference(static_cast<qint32>(slot->sequence.loadAcquire() - position));
+
+		if (difference == 0)
+		{
+			if (m_queueWritePosition.testAndSetOrdered(position, (position + 1), position))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			m_droppedMessages.fetchAndAddRelaxed(1);
+
+			slot = nullptr;
+
+			break;
+		}
+		else
+		{
+			position = m_queueWritePosition.loadAcquire();
+		}
+	}
+
+	if (slot)
+	{
+		slot->message.time = QDateTime::currentDateTime();
+		slot->message.note = note;
+		slot->message.source = source;
+		slot->message.category = category;
+		slot->message.level = level;
+		slot->message.line = line;
+		slot->message.window = window;
+		slot->sequence.storeRelease(position + 1);
+	}
+
+	if (m_isDeliveryScheduled.testAndSetOrdered(0, 1))
+	{
+		QMetaObject::invokeMethod(m_instance, "scheduleDelivery", Qt::QueuedConnection);
+	}
+}
+
+void Console::scheduleDelivery()
+{
+	if (m_deliveryTimer == 0)
+	{
+		m_deliveryTimer = startTimer(DeliveryInterval);
+	}
 }
 
 Console* Console::getInstance()
@@ -20,6 +20,7 @@
 #ifndef OTTER_CONSOLE_H
 #define OTTER_CONSOLE_H
 
+#include <QtCore/QAtomicInteger>
 #include <QtCore/QDateTime>
 #include <QtCore/QObject>
 #include <QtCore/QVector>
@@ -68,14 +69,39 @@ public:
 	static QVector<Console::Message> getMessages();
 
 protected:
+	enum QueueLimit
+	{
+		QueueSize = 1024,
+		MessagesLimit = 1000,
+		DeliveryInterval = 100
+	};
+
+	struct QueueSlot
+	{
+		Message message;
+		QAtomicInteger<quint32> sequence;
+	};
+
 	explicit Console(QObject *parent = nullptr);
 
+	void timerEvent(QTimerEvent *event) override;
+
+protected slots:
+	void scheduleDelivery();
+
 private:
+	int m_deliveryTimer;
+
 	static Console *m_instance;
+	static QueueSlot *m_queue;
 	static QVector<Message> m_messages;
+	static QAtomicInteger<quint32> m_queueWritePosition;
+	static QAtomicInteger<quint32> m_droppedMessages;
+	static QAtomicInt m_isDeliveryScheduled;
+	static quint32 m_queueReadPosition;
 
 signals:
-	void messageAdded(const Console::Message &message);
+	void messagesAdded(const QVector<Console::Message> &messages);
 };
 
 }
@@ -28,6 +28,7 @@
 
 #include <QtCore/QDir>
 #include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
 #include <QtGui/QStandardItemModel>
 
@@ -36,7 +37,14 @@ namespace Otter
 
 ContentBlockingManager* ContentBlockingManager::m_instance(nullptr);
 QVector<ContentBlockingProfile*> ContentBlockingManager::m_profiles;
+QCache<QString, ContentBlockingManager::CheckResult> ContentBlockingManager::m_checkResults(2000);
+QCache<QString, ContentBlockingManager::CosmeticFiltersResult> ContentBlockingManager::m_cosmeticFilters(500);
+QCache<QString, QStringList> ContentBlockingManager::m_styleSheets(50);
+QCache<QString, QString> ContentBlockingManager::m_styleSheetsScripts(50);
+QMutex ContentBlockingManager::m_checkResultsMutex;
+ContentBlockingManager::CacheStatistics ContentBlockingManager::m_cacheStatistics;
 ContentBlockingManager::CosmeticFiltersMode ContentBlockingManager::m_cosmeticFiltersMode(AllFiltersMode);
+quint64 ContentBlockingManager::m_cacheGeneration(0);
 bool ContentBlockingManager::m_areWildcardsEnabled(true);
 
 ContentBlockingManager::ContentBlockingManager(QObject *parent) : QObject(parent),
@@ -108,6 +116,13 @@ void ContentBlockingManager::timerEvent(QTimerEvent *event)
 				profileObject.insert(QLatin1String("lastUpdate"), lastUpdate.toString(Qt::ISODate));
 			}
 
+			const QByteArray entityTag(profile->getEntityTag());
+
+			if (!entityTag.isEmpty())
+			{
+				profileObject.insert(QLatin1String("entityTag"), QString::fromLatin1(entityTag));
+			}
+
 			if (profile->getFlags().testFlag(ContentBlockingProfile::HasCustomTitleFlag))
 			{
 				profileObject.insert(QLatin1String("title"), profile->getTitle());
@@ -159,9 +174,22 @@ void ContentBlockingManager::addProfile(ContentBlockingProfile *profile)
 		getInstance()->scheduleSave();
 
 		connect(profile, SIGNAL(profileModified(QString)), m_instance, SLOT(scheduleSave()));
+		connect(profile, SIGNAL(profileModified(QString)), m_instance, SLOT(handleProfileModified()));
 	}
 }
 
+void ContentBlockingManager::clearCache()
+{
+	QMutexLocker locker(&m_checkResultsMutex);
+
+	++m_cacheGeneration;
+
+	m_checkResults.clear();
+	m_cosmeticFilters.clear();
+	m_styleSheets.clear();
+	m_styleSheetsScripts.clear();
+}
+
 void ContentBlockingManager::handleOptionChanged(int identifier, const QVariant &value)
 {
 	switch (identifier)
@@ -197,6 +225,13 @@ void ContentBlockingManager::handleOptionChanged(int identifier, const QVariant
 	{
 		m_profiles[i]->clear();
 	}
+
+	clearCache();
+}
+
+void ContentBlockingManager::handleProfileModified()
+{
+	clearCache();
 }
 
 void ContentBlockingManager::removeProfile(ContentBlockingProfile *profile)
@@ -229,6 +264,8 @@ void ContentBlockingManager::removeProfile(ContentBlockingProfile *profile)
 
 	m_profiles.removeAll(profile);
 
+	clearCache();
+
 	profile->deleteLater();
 }
 
@@ -344,6 +381,29 @@ ContentBlockingManager::CheckResult ContentBlockingManager::checkUrl(const QVect
 		return CheckResult();
 	}
 
+	const QString cacheKey(baseUrl.host() + QLatin1Char(' ') + QString::number(resourceType) + QLatin1Char(' ') + createProfilesKey(profiles) + QLatin1Char(' ') + requestUrl.url());
+
+	m_checkResultsMutex.lock();
+
+	const CheckResult *cachedResult(m_checkResults.object(cacheKey));
+
+	if (cachedResult)
+	{
+		const CheckResult result(*cachedResult);
+
+		++m_cacheStatistics.hits;
+
+		m_checkResultsMutex.unlock();
+
+		return result;
+	}
+
+	++m_cacheStatistics.misses;
+
+	const quint64 cacheGeneration(m_cacheGeneration);
+
+	m_checkResultsMutex.unlock();
+
 	CheckResult result;
 
 	for (int i = 0; i < profiles.count(); ++i)
@@ -358,11 +418,20 @@ ContentBlockingManager::CheckResult ContentBlockingManager::checkUrl(const QVect
 			}
 			else if (currentResult.isException)
 			{
-				return currentResult;
+				result = currentResult;
+
+				break;
 			}
 		}
 	}
 
+	QMutexLocker locker(&m_checkResultsMutex);
+
+	if (cacheGeneration == m_cacheGeneration)
+	{
+		m_checkResults.insert(cacheKey, new CheckResult(result));
+	}
+
 	return result;
 }
 
@@ -384,49 +453,143 @@ QStringList ContentBlockingManager::createSubdomainList(const QString &domain)
 	return subdomainList;
 }
 
-QStringList ContentBlockingManager::getStyleSheet(const QVector<int> &profiles)
+QString ContentBlockingManager::createProfilesKey(const QVector<int> &profiles)
 {
-	QStringList styleSheet;
+	QString key;
 
 	for (int i = 0; i < profiles.count(); ++i)
 	{
-		if (profiles[i] >= 0 && profiles[i] < m_profiles.count())
-		{
-			styleSheet += m_profiles.at(profiles[i])->getStyleSheet();
-		}
+		key += QString::number(profiles.at(i)) + QLatin1Char(',');
 	}
 
-	return styleSheet;
+	return key;
 }
 
-QStringList ContentBlockingManager::getStyleSheetBlackList(const QString &domain, const QVector<int> &profiles)
+ContentBlockingManager::CosmeticFiltersResult ContentBlockingManager::getCosmeticFilters(const QVector<int> &profiles, const QUrl &requestUrl)
 {
-	QStringList data;
+	if (profiles.isEmpty() || m_cosmeticFiltersMode == NoFiltersMode)
+	{
+		return CosmeticFiltersResult();
+	}
+
+	const CosmeticFiltersMode mode(checkUrl(profiles, requestUrl, requestUrl, NetworkManager::OtherType).comesticFiltersMode);
+
+	if (mode == NoFiltersMode)
+	{
+		return CosmeticFiltersResult();
+	}
+
+	const QString host(requestUrl.host());
+	const QString cacheKey(createProfilesKey(profiles) + QLatin1Char(' ') + host);
+
+	m_checkResultsMutex.lock();
+
+	const CosmeticFiltersResult *cachedResult(m_cosmeticFilters.object(cacheKey));
+
+	if (cachedResult)
+	{
+		CosmeticFiltersResult result(*cachedResult);
+		result.mode = mode;
+
+		m_checkResultsMutex.unlock();
+
+		return result;
+	}
+
+	const quint64 cacheGeneration(m_cacheGeneration);
+
+	m_checkResultsMutex.unlock();
+
+	const QStringList domains(createSubdomainList(host));
+	CosmeticFiltersResult result;
 
 	for (int i = 0; i < profiles.count(); ++i)
 	{
 		if (profiles[i] >= 0 && profiles[i] < m_profiles.count())
 		{
-			data.append(m_profiles.at(profiles[i])->getStyleSheetBlackList(domain));
+			const CosmeticFiltersResult profileResult(m_profiles.at(profiles[i])->getCosmeticFilters(domains));
+
+			result.rules.append(profileResult.rules);
+			result.exceptions.append(profileResult.exceptions);
 		}
 	}
 
-	return data;
+	m_checkResultsMutex.lock();
+
+	if (cacheGeneration == m_cacheGeneration)
+	{
+		m_cosmeticFilters.insert(cacheKey, new CosmeticFiltersResult(result));
+	}
+
+	m_checkResultsMutex.unlock();
+
+	result.mode = mode;
+
+	return result;
 }
 
-QStringList ContentBlockingManager::getStyleSheetWhiteList(const QString &domain, const QVector<int> &profiles)
+QStringList ContentBlockingManager::getStyleSheet(const QVector<int> &profiles)
 {
-	QStringList data;
+	const QString cacheKey(createProfilesKey(profiles));
+	QMutexLocker locker(&m_checkResultsMutex);
+
+	const QStringList *cachedStyleSheet(m_styleSheets.object(cacheKey));
+
+	if (cachedStyleSheet)
+	{
+		return *cachedStyleSheet;
+	}
+
+	const quint64 cacheGeneration(m_cacheGeneration);
+
+	locker.unlock();
+
+	QStringList styleSheet;
 
 	for (int i = 0; i < profiles.count(); ++i)
 	{
 		if (profiles[i] >= 0 && profiles[i] < m_profiles.count())
 		{
-			data.append(m_profiles.at(profiles[i])->getStyleSheetWhiteList(domain));
+			styleSheet += m_profiles.at(profiles[i])->getStyleSheet();
 		}
 	}
 
-	return data;
+	locker.relock();
+
+	if (cacheGeneration == m_cacheGeneration)
+	{
+		m_styleSheets.insert(cacheKey, new QStringList(styleSheet));
+	}
+
+	return styleSheet;
+}
+
+QString ContentBlockingManager::getStyleSheetScript(const QVector<int> &profiles)
+{
+	const QString cacheKey(createProfilesKey(profiles));
+	QMutexLocker locker(&m_checkResultsMutex);
+
+	const QString *cachedScript(m_styleSheetsScripts.object(cacheKey));
+
+	if (cachedScript)
+	{
+		return *cachedScript;
+	}
+
+	const quint64 cacheGeneration(m_cacheGeneration);
+
+	locker.unlock();
+
+	const QString script(QLatin1String("var contentBlockingStyleSheet = ") + QString::fromUtf8(QJsonDocument(QJsonArray::fromStringList(getStyleSheet(profiles))).toJson(QJsonDocument::Compact)) + QLatin1Char(';'));
+
+	locker.relock();
+
+	if (cacheGeneration == m_cacheGeneration)
+	{
+		m_styleSheetsScripts.insert(cacheKey, new QString(script));
+	}
+
+	return script;
 }
 
 QVector<ContentBlockingProfile*> ContentBlockingManager::getProfiles()
@@ -523,10 +686,13 @@ QVector<ContentBlockingProfile*> ContentBlockingManager::getProfiles()
 
 			ContentBlockingProfile *profile(new ContentBlockingProfile(profiles.at(i), title, updateUrl, QDateTime::fromString(profileObject.value(QLatin1String("lastUpdate")).toString(), Qt::ISODate), parsedLanguages, profileObject.value(QLatin1String("updateInterval")).toInt(), categoryTitles.value(profileObject.value(QLatin1String("category")).toString()), flags, m_instance));
 
+			profile->setEntityTag(profileObject.value(QLatin1String("entityTag")).toString().toLatin1());
+
 			m_profiles.append(profile);
 
 			connect(profile, SIGNAL(profileModified(QString)), m_instance, SIGNAL(profileModified(QString)));
 			connect(profile, SIGNAL(profileModified(QString)), m_instance, SLOT(scheduleSave()));
+			connect(profile, SIGNAL(profileModified(QString)), m_instance, SLOT(handleProfileModified()));
 		}
 
 		m_profiles.squeeze();
@@ -561,6 +727,15 @@ ContentBlockingManager::CosmeticFiltersMode ContentBlockingManager::getCosmeticF
 	return m_cosmeticFiltersMode;
 }
 
+ContentBlockingManager::CacheStatistics ContentBlockingManager::getCacheStatistics()
+{
+	QMutexLocker locker(&m_checkResultsMutex);
+	CacheStatistics statistics(m_cacheStatistics);
+	statistics.size = m_checkResults.size();
+
+	return statistics;
+}
+
 bool ContentBlockingManager::areWildcardsEnabled()
 {
 	return m_areWildcardsEnabled;
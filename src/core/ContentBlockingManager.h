@@ -23,6 +23,8 @@
 
 #include "NetworkManager.h"
 
+#include <QtCore/QCache>
+#include <QtCore/QMutex>
 #include <QtCore/QUrl>
 #include <QtGui/QStandardItemModel>
 
@@ -52,20 +54,36 @@ public:
 		bool isException = false;
 	};
 
+	struct CosmeticFiltersResult
+	{
+		QStringList rules;
+		QStringList exceptions;
+		CosmeticFiltersMode mode = NoFiltersMode;
+	};
+
+	struct CacheStatistics
+	{
+		quint64 hits = 0;
+		quint64 misses = 0;
+		int size = 0;
+	};
+
 	static void createInstance();
 	static void addProfile(ContentBlockingProfile *profile);
+	static void clearCache();
 	static void removeProfile(ContentBlockingProfile *profile);
 	static QStandardItemModel* createModel(QObject *parent, const QStringList &profiles);
 	static ContentBlockingManager* getInstance();
 	static ContentBlockingProfile* getProfile(const QString &profile);
 	static CheckResult checkUrl(const QVector<int> &profiles, const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType);
 	static QStringList createSubdomainList(const QString &domain);
+	static CosmeticFiltersResult getCosmeticFilters(const QVector<int> &profiles, const QUrl &requestUrl);
 	static QStringList getStyleSheet(const QVector<int> &profiles);
-	static QStringList getStyleSheetBlackList(const QString &domain, const QVector<int> &profiles);
-	static QStringList getStyleSheetWhiteList(const QString &domain, const QVector<int> &profiles);
+	static QString getStyleSheetScript(const QVector<int> &profiles);
 	static QVector<ContentBlockingProfile*> getProfiles();
 	static QVector<int> getProfileList(const QStringList &names);
 	static CosmeticFiltersMode getCosmeticFiltersMode();
+	static CacheStatistics getCacheStatistics();
 	static bool areWildcardsEnabled();
 	static bool updateProfile(const QString &profile);
 
@@ -75,17 +93,27 @@ public slots:
 protected:
 	explicit ContentBlockingManager(QObject *parent);
 
+	static QString createProfilesKey(const QVector<int> &profiles);
+
 	void timerEvent(QTimerEvent *event) override;
 
 protected slots:
 	void handleOptionChanged(int identifier, const QVariant &value);
+	void handleProfileModified();
 
 private:
 	int m_saveTimer;
 
 	static ContentBlockingManager *m_instance;
 	static QVector<ContentBlockingProfile*> m_profiles;
+	static QCache<QString, CheckResult> m_checkResults;
+	static QCache<QString, CosmeticFiltersResult> m_cosmeticFilters;
+	static QCache<QString, QStringList> m_styleSheets;
+	static QCache<QString, QString> m_styleSheetsScripts;
+	static QMutex m_checkResultsMutex;
+	static CacheStatistics m_cacheStatistics;
 	static CosmeticFiltersMode m_cosmeticFiltersMode;
+	static quint64 m_cacheGeneration;
 	static bool m_areWildcardsEnabled;
 
 signals:
@@ -25,9 +25,16 @@
 #include "NetworkManagerFactory.h"
 #include "SessionsManager.h"
 
+#include <QtConcurrent/QtConcurrentMap>
 #include <QtConcurrent/QtConcurrentRun>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
 #include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QQueue>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSet>
 #include <QtCore/QTextStream>
 #include <QtNetwork/QNetworkReply>
 #include <QtNetwork/QNetworkRequest>
@@ -36,18 +43,20 @@ namespace Otter
 {
 
 QVector<QChar> ContentBlockingProfile::m_separators({QLatin1Char('_'), QLatin1Char('-'), QLatin1Char('.'), QLatin1Char('%')});
+QVector<QChar> ContentBlockingProfile::m_domainSeparators({QLatin1Char(':'), QLatin1Char('?'), QLatin1Char('&'), QLatin1Char('/'), QLatin1Char('=')});
 QHash<QString, ContentBlockingProfile::RuleOption> ContentBlockingProfile::m_options({{QLatin1String("third-party"), ThirdPartyOption}, {QLatin1String("stylesheet"), StyleSheetOption}, {QLatin1String("image"), ImageOption}, {QLatin1String("script"), ScriptOption}, {QLatin1String("object"), ObjectOption}, {QLatin1String("object-subrequest"), ObjectSubRequestOption}, {QLatin1String("object_subrequest"), ObjectSubRequestOption}, {QLatin1String("subdocument"), SubDocumentOption}, {QLatin1String("xmlhttprequest"), XmlHttpRequestOption}, {QLatin1String("websocket"), WebSocketOption}, {QLatin1String("elemhide"), ElementHideOption}, {QLatin1String("generichide"), GenericHideOption}});
 QHash<NetworkManager::ResourceType, ContentBlockingProfile::RuleOption> ContentBlockingProfile::m_resourceTypes({{NetworkManager::ImageType, ImageOption}, {NetworkManager::ScriptType, ScriptOption}, {NetworkManager::StyleSheetType, StyleSheetOption}, {NetworkManager::ObjectType, ObjectOption}, {NetworkManager::XmlHttpRequestType, XmlHttpRequestOption}, {NetworkManager::SubFrameType, SubDocumentOption}, {NetworkManager::ObjectSubrequestType, ObjectSubRequestOption}, {NetworkManager::WebSocketType, WebSocketOption}});
 
 ContentBlockingProfile::ContentBlockingProfile(const QString &name, const QString &title, const QUrl &updateUrl, const QDateTime &lastUpdate, const QStringList &languages, int updateInterval, const ProfileCategory &category, const ProfileFlags &flags, QObject *parent) : QObject(parent),
-	m_root(nullptr),
 	m_networkReply(nullptr),
+	m_downloadFile(nullptr),
 	m_name(name),
 	m_title(title),
 	m_updateUrl(updateUrl),
 	m_lastUpdate(lastUpdate),
 	m_category(category),
 	m_flags(flags),
+	m_rulesSetGeneration(0),
 	m_updateInterval(updateInterval),
 	m_isUpdating(false),
 	m_isEmpty(true),
@@ -65,24 +74,28 @@ ContentBlockingProfile::ContentBlockingProfile(const QString &name, const QStrin
 		}
 	}
 
+	m_threadPool.setMaxThreadCount(1);
+
 	loadHeader(getPath());
 }
 
+ContentBlockingProfile::~ContentBlockingProfile()
+{
+	m_threadPool.waitForDone();
+}
+
 void ContentBlockingProfile::clear()
 {
+	QMutexLocker locker(&m_mutex);
+
 	if (!m_wasLoaded)
 	{
 		return;
 	}
 
-	if (m_root)
-	{
-		QtConcurrent::run(this, &ContentBlockingProfile::deleteNode, m_root);
-	}
+	m_rulesSet.clear();
 
-	m_styleSheet.clear();
-	m_styleSheetWhiteList.clear();
-	m_styleSheetBlackList.clear();
+	++m_rulesSetGeneration;
 
 	m_wasLoaded = false;
 }
@@ -141,7 +154,7 @@ void ContentBlockingProfile::loadHeader(const QString &path)
 	}
 }
 
-void ContentBlockingProfile::parseRuleLine(QString line)
+void ContentBlockingProfile::parseRuleLine(QString line, RulesChunk *chunk)
 {
 	if (line.indexOf(QLatin1Char('!')) == 0 || line.isEmpty())
 	{
@@ -152,7 +165,7 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 	{
 		if (ContentBlockingManager::getCosmeticFiltersMode() == ContentBlockingManager::AllFiltersMode)
 		{
-			m_styleSheet.append(line.mid(2));
+			chunk->styleSheet.append(line.mid(2));
 		}
 
 		return;
@@ -162,7 +175,7 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 	{
 		if (ContentBlockingManager::getCosmeticFiltersMode() != ContentBlockingManager::NoFiltersMode)
 		{
-			parseStyleSheetRule(line.split(QLatin1String("##")), m_styleSheetBlackList);
+			parseStyleSheetRule(line.split(QLatin1String("##")), chunk->styleSheetBlackList);
 		}
 
 		return;
@@ -172,7 +185,7 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 	{
 		if (ContentBlockingManager::getCosmeticFiltersMode() != ContentBlockingManager::NoFiltersMode)
 		{
-			parseStyleSheetRule(line.split(QLatin1String("#@#")), m_styleSheetWhiteList);
+			parseStyleSheetRule(line.split(QLatin1String("#@#")), chunk->styleSheetWhiteList);
 		}
 
 		return;
@@ -283,10 +296,31 @@ void ContentBlockingProfile::parseRuleLine(QString line)
 		}
 	}
 
-	addRule(new ContentBlockingRule(rule, blockedDomains, allowedDomains, ruleOptions, ruleMatch, isException, needsDomainCheck), line);
+	ParsedRule parsedRule;
+	parsedRule.rule.rule = rule;
+	parsedRule.rule.ruleOptions = ruleOptions;
+	parsedRule.rule.ruleMatch = ruleMatch;
+	parsedRule.rule.isException = isException;
+	parsedRule.rule.needsDomainCheck = needsDomainCheck;
+	parsedRule.ruleString = line;
+	parsedRule.blockedDomains = blockedDomains;
+	parsedRule.allowedDomains = allowedDomains;
+
+	if (needsDomainCheck && ruleMatch == ContainsMatch)
+	{
+		const QString host(line.endsWith(QLatin1Char('^')) ? line.left(line.length() - 1) : line);
+
+		if (isPlainHost(host))
+		{
+			parsedRule.ruleString = host;
+			parsedRule.isHostRule = true;
+		}
+	}
+
+	chunk->rules.append(parsedRule);
 }
 
-void ContentBlockingProfile::parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list) const
+void ContentBlockingProfile::parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list)
 {
 	const QStringList domains(line.at(0).split(QLatin1Char(',')));
 
@@ -296,398 +330,873 @@ void ContentBlockingProfile::parseStyleSheetRule(const QStringList &line, QMulti
 	}
 }
 
-void ContentBlockingProfile::addRule(ContentBlockingRule *rule, const QString &ruleString) const
+void ContentBlockingProfile::addRule(RulesSet *rulesSet, ContentBlockingRule rule, const QString &ruleString)
 {
-	Node *node(m_root);
+	int node(0);
 
 	for (int i = 0; i < ruleString.length(); ++i)
 	{
 		const QChar value(ruleString.at(i));
-		bool childrenExists(false);
+		int nextNode(findChild(rulesSet, node, value));
 
-		for (int j = 0; j < node->children.count(); ++j)
+		if (nextNode < 0)
 		{
-			Node *nextNode(node->children.at(j));
+			Node newNode;
+			newNode.value = value;
+			newNode.nextSibling = rulesSet->nodes.at(node).firstChild;
 
-			if (nextNode->value == value)
-			{
-				node = nextNode;
+			nextNode = rulesSet->nodes.count();
 
-				childrenExists = true;
+			rulesSet->nodes.append(newNode);
+			rulesSet->nodes[node].firstChild = nextNode;
+			rulesSet->edges.insert(getEdgeKey(node, value), nextNode);
 
-				break;
+			if (value == QLatin1Char('^') || value == QLatin1Char('*'))
+			{
+				rulesSet->nodes[node].hasWildcards = true;
 			}
 		}
 
-		if (!childrenExists)
-		{
-			Node *newNode(new Node());
-			newNode->value = value;
+		node = nextNode;
+	}
 
-			if (value == QLatin1Char('^'))
-			{
-				node->children.insert(0, newNode);
-			}
-			else
+	rule.nextRule = rulesSet->nodes.at(node).firstRule;
+
+	rulesSet->nodes[node].firstRule = rulesSet->rules.count();
+	rulesSet->rules.append(rule);
+}
+
+void ContentBlockingProfile::addRules(RulesSet *rulesSet, const RulesChunk &chunk)
+{
+	rulesSet->styleSheet.append(chunk.styleSheet);
+	rulesSet->styleSheetBlackList += chunk.styleSheetBlackList;
+	rulesSet->styleSheetWhiteList += chunk.styleSheetWhiteList;
+
+	for (int i = 0; i < chunk.rules.count(); ++i)
+	{
+		const ParsedRule &parsedRule(chunk.rules.at(i));
+		ContentBlockingRule rule(parsedRule.rule);
+		rule.blockedDomainsOffset = addDomains(rulesSet, parsedRule.blockedDomains);
+		rule.blockedDomainsAmount = parsedRule.blockedDomains.count();
+		rule.allowedDomainsOffset = addDomains(rulesSet, parsedRule.allowedDomains);
+		rule.allowedDomainsAmount = parsedRule.allowedDomains.count();
+
+		if (parsedRule.isHostRule)
+		{
+			addHostRule(rulesSet, rule, parsedRule.ruleString);
+		}
+		else
+		{
+			if (rule.isException)
 			{
-				node->children.append(newNode);
+				rulesSet->hasExceptionRules = true;
 			}
 
-			node = newNode;
+			addRule(rulesSet, rule, parsedRule.ruleString);
 		}
 	}
+}
+
+void ContentBlockingProfile::addHostRule(RulesSet *rulesSet, ContentBlockingRule rule, const QString &host)
+{
+	rule.nextRule = rulesSet->hostRules.value(host, -1);
 
-	node->rules.append(rule);
+	rulesSet->hostRules[host] = rulesSet->rules.count();
+	rulesSet->rules.append(rule);
 }
 
-void ContentBlockingProfile::deleteNode(Node *node) const
+void ContentBlockingProfile::removeRules(RulesSet *rulesSet, const RulesChunk &chunk)
 {
-	for (int i = 0; i < node->children.count(); ++i)
+	for (int i = 0; i < chunk.styleSheet.count(); ++i)
 	{
-		deleteNode(node->children.at(i));
+		rulesSet->styleSheet.removeOne(chunk.styleSheet.at(i));
 	}
 
-	for (int i = 0; i < node->rules.count(); ++i)
+	QMultiHash<QString, QString>::const_iterator iterator;
+
+	for (iterator = chunk.styleSheetBlackList.constBegin(); iterator != chunk.styleSheetBlackList.constEnd(); ++iterator)
 	{
-		delete node->rules.at(i);
+		rulesSet->styleSheetBlackList.remove(iterator.key(), iterator.value());
 	}
 
-	delete node;
-}
-
-ContentBlockingManager::CheckResult ContentBlockingProfile::checkUrlSubstring(Node *node, const QString &subString, QString currentRule, NetworkManager::ResourceType resourceType)
-{
-	ContentBlockingManager::CheckResult result;
-	ContentBlockingManager::CheckResult currentResult;
-
-	for (int i = 0; i < subString.length(); ++i)
+	for (iterator = chunk.styleSheetWhiteList.constBegin(); iterator != chunk.styleSheetWhiteList.constEnd(); ++iterator)
 	{
-		const QChar treeChar(subString.at(i));
-		bool childrenExists(false);
-
-		currentResult = evaluateRulesInNode(node, currentRule, resourceType);
+		rulesSet->styleSheetWhiteList.remove(iterator.key(), iterator.value());
+	}
 
-		if (currentResult.isBlocked)
-		{
-			result = currentResult;
-		}
-		else if (currentResult.isException)
-		{
-			return currentResult;
-		}
+	for (int i = 0; i < chunk.rules.count(); ++i)
+	{
+		const ParsedRule &parsedRule(chunk.rules.at(i));
 
-		for (int j = 0; j < node->children.count(); ++j)
+		if (parsedRule.isHostRule)
 		{
-			Node *nextNode(node->children.at(j));
-
-			if (nextNode->value == QLatin1Char('*'))
-			{
-				const QString wildcardSubString(subString.mid(i));
-
-				for (int k = 0; k < wildcardSubString.length(); ++k)
-				{
-					currentResult = checkUrlSubstring(nextNode, wildcardSubString.right(wildcardSubString.length() - k), currentRule + wildcardSubString.left(k), resourceType);
-
-					if (currentResult.isBlocked)
-					{
-						result = currentResult;
-					}
-					else if (currentResult.isException)
-					{
-						return currentResult;
-					}
-				}
-			}
-
-			if (nextNode->value == QLatin1Char('^') && !treeChar.isDigit() && !treeChar.isLetter() && !m_separators.contains(treeChar))
+			if (rulesSet->hostRules.contains(parsedRule.ruleString))
 			{
-				currentResult = checkUrlSubstring(nextNode, subString.mid(i), currentRule, resourceType);
+				const int firstRule(removeRule(rulesSet, rulesSet->hostRules.value(parsedRule.ruleString), parsedRule.rule.rule));
 
-				if (currentResult.isBlocked)
+				if (firstRule < 0)
 				{
-					result = currentResult;
+					rulesSet->hostRules.remove(parsedRule.ruleString);
 				}
-				else if (currentResult.isException)
+				else
 				{
-					return currentResult;
+					rulesSet->hostRules[parsedRule.ruleString] = firstRule;
 				}
 			}
 
-			if (nextNode->value == treeChar)
-			{
-				node = nextNode;
+			continue;
+		}
 
-				childrenExists = true;
+		int node(0);
 
-				break;
-			}
+		for (int j = 0; (j < parsedRule.ruleString.length() && node >= 0); ++j)
+		{
+			node = findChild(rulesSet, node, parsedRule.ruleString.at(j));
 		}
 
-		if (!childrenExists)
+		if (node >= 0)
 		{
-			return result;
+			rulesSet->nodes[node].firstRule = removeRule(rulesSet, rulesSet->nodes.at(node).firstRule, parsedRule.rule.rule);
 		}
-
-		currentRule += treeChar;
 	}
+}
 
-	currentResult = evaluateRulesInNode(node, currentRule, resourceType);
+void ContentBlockingProfile::compactRules(RulesSet *rulesSet)
+{
+	RulesSet compactedRulesSet;
+	compactedRulesSet.styleSheet = rulesSet->styleSheet;
+	compactedRulesSet.styleSheetBlackList = rulesSet->styleSheetBlackList;
+	compactedRulesSet.styleSheetWhiteList = rulesSet->styleSheetWhiteList;
+	compactedRulesSet.nodes.append(Node());
 
-	if (currentResult.isBlocked)
-	{
-		result = currentResult;
-	}
-	else if (currentResult.isException)
+	QHash<QString, int>::const_iterator iterator;
+
+	for (iterator = rulesSet->hostRules.constBegin(); iterator != rulesSet->hostRules.constEnd(); ++iterator)
 	{
-		return currentResult;
+		const QVector<ContentBlockingRule> rules(collectRules(rulesSet, &compactedRulesSet, iterator.value()));
+
+		for (int i = (rules.count() - 1); i >= 0; --i)
+		{
+			addHostRule(&compactedRulesSet, rules.at(i), iterator.key());
+		}
 	}
 
-	for (int i = 0; i < node->children.count(); ++i)
+	QVector<QPair<int, QString> > nodes({qMakePair(0, QString())});
+
+	while (!nodes.isEmpty())
 	{
-		if (node->children.at(i)->value == QLatin1Char('^'))
-		{
-			currentResult = evaluateRulesInNode(node, currentRule, resourceType);
+		const QPair<int, QString> node(nodes.takeLast());
+		const QVector<ContentBlockingRule> rules(collectRules(rulesSet, &compactedRulesSet, rulesSet->nodes.at(node.first).firstRule));
 
-			if (currentResult.isBlocked)
-			{
-				result = currentResult;
-			}
-			else if (currentResult.isException)
+		for (int i = (rules.count() - 1); i >= 0; --i)
+		{
+			if (rules.at(i).isException)
 			{
-				return currentResult;
+				compactedRulesSet.hasExceptionRules = true;
 			}
+
+			addRule(&compactedRulesSet, rules.at(i), node.second);
+		}
+
+		for (int i = rulesSet->nodes.at(node.first).firstChild; i >= 0; i = rulesSet->nodes.at(i).nextSibling)
+		{
+			nodes.append(qMakePair(i, (node.second + rulesSet->nodes.at(i).value)));
 		}
 	}
 
-	return result;
+	*rulesSet = compactedRulesSet;
 }
 
-ContentBlockingManager::CheckResult ContentBlockingProfile::checkRuleMatch(ContentBlockingRule *rule, const QString &currentRule, NetworkManager::ResourceType resourceType) const
+QString ContentBlockingProfile::saveCache(const RulesSet *rulesSet, const QString &path, const QString &cachePath)
 {
-	switch (rule->ruleMatch)
+	const QFileInfo sourceInformation(path);
+
+	if (!sourceInformation.exists())
 	{
-		case StartMatch:
-			if (!m_requestUrl.startsWith(currentRule))
-			{
-				return ContentBlockingManager::CheckResult();
-			}
+		return QString();
+	}
 
-			break;
-		case EndMatch:
-			if (!m_requestUrl.endsWith(currentRule))
-			{
-				return ContentBlockingManager::CheckResult();
-			}
+	QSaveFile file(cachePath);
 
-			break;
-		case ExactMatch:
-			if (m_requestUrl != currentRule)
-			{
-				return ContentBlockingManager::CheckResult();
-			}
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return file.errorString();
+	}
 
-			break;
-		default:
-			if (!m_requestUrl.contains(currentRule))
-			{
-				return ContentBlockingManager::CheckResult();
-			}
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_4);
+	stream << static_cast<quint32>(CacheMagic) << static_cast<quint32>(CacheVersion) << sourceInformation.size() << sourceInformation.lastModified().toMSecsSinceEpoch() << static_cast<quint8>(ContentBlockingManager::getCosmeticFiltersMode()) << ContentBlockingManager::areWildcardsEnabled();
+	stream << rulesSet->domains << rulesSet->ruleDomains << rulesSet->hostRules << rulesSet->hasExceptionRules << static_cast<qint32>(rulesSet->rules.count());
 
-			break;
+	for (int i = 0; i < rulesSet->rules.count(); ++i)
+	{
+		const ContentBlockingRule &rule(rulesSet->rules.at(i));
+
+		stream << rule.rule << static_cast<quint32>(rule.ruleOptions) << static_cast<quint8>(rule.ruleMatch) << static_cast<qint32>(rule.blockedDomainsOffset) << static_cast<qint32>(rule.blockedDomainsAmount) << static_cast<qint32>(rule.allowedDomainsOffset) << static_cast<qint32>(rule.allowedDomainsAmount) << static_cast<qint32>(rule.nextRule) << rule.isException << rule.needsDomainCheck;
 	}
 
-	const QStringList requestSubdomainList(ContentBlockingManager::createSubdomainList(m_requestHost));
+	stream << static_cast<qint32>(rulesSet->nodes.count());
 
-	if (rule->needsDomainCheck && !requestSubdomainList.contains(currentRule.left(currentRule.indexOf(m_domainExpression))))
+	for (int i = 0; i < rulesSet->nodes.count(); ++i)
 	{
-		return ContentBlockingManager::CheckResult();
+		const Node &node(rulesSet->nodes.at(i));
+
+		stream << static_cast<quint16>(node.value.unicode()) << static_cast<qint32>(node.firstChild) << static_cast<qint32>(node.nextSibling) << static_cast<qint32>(node.firstRule) << static_cast<qint32>(node.failureNode) << static_cast<qint32>(node.outputNode) << static_cast<qint32>(node.depth) << node.hasWildcards;
 	}
 
-	const bool hasBlockedDomains(!rule->blockedDomains.isEmpty());
-	const bool hasAllowedDomains(!rule->allowedDomains.isEmpty());
-	bool isBlocked(hasBlockedDomains ? resolveDomainExceptions(m_baseUrlHost, rule->blockedDomains) : true);
-	isBlocked = (hasAllowedDomains ? !resolveDomainExceptions(m_baseUrlHost, rule->allowedDomains) : isBlocked);
+	stream << rulesSet->styleSheet << static_cast<const QHash<QString, QString>&>(rulesSet->styleSheetBlackList) << static_cast<const QHash<QString, QString>&>(rulesSet->styleSheetWhiteList);
 
-	if (rule->ruleOptions.testFlag(ThirdPartyExceptionOption) || rule->ruleOptions.testFlag(ThirdPartyOption))
+	if (stream.status() != QDataStream::Ok || !file.commit())
 	{
-		if (m_baseUrlHost.isEmpty() || requestSubdomainList.contains(m_baseUrlHost))
-		{
-			isBlocked = rule->ruleOptions.testFlag(ThirdPartyExceptionOption);
-		}
-		else if (!hasBlockedDomains && !hasAllowedDomains)
-		{
-			isBlocked = rule->ruleOptions.testFlag(ThirdPartyOption);
-		}
+		return file.errorString();
 	}
 
-	if (rule->ruleOptions != NoOption)
+	return QString();
+}
+
+void ContentBlockingProfile::compileRules(RulesSet *rulesSet)
+{
+	QVector<Node> &nodes(rulesSet->nodes);
+	QQueue<int> queue;
+
+	nodes[0].failureNode = -1;
+	nodes[0].outputNode = -1;
+	nodes[0].depth = 0;
+
+	for (int i = nodes.at(0).firstChild; i >= 0; i = nodes.at(i).nextSibling)
 	{
-		QHash<NetworkManager::ResourceType, RuleOption>::const_iterator iterator;
+		nodes[i].failureNode = 0;
+		nodes[i].depth = 1;
 
-		for (iterator = m_resourceTypes.begin(); iterator != m_resourceTypes.end(); ++iterator)
+		queue.enqueue(i);
+	}
+
+	while (!queue.isEmpty())
+	{
+		const int node(queue.dequeue());
+		const int failureNode(nodes.at(node).failureNode);
+
+		nodes[node].outputNode = ((nodes.at(failureNode).hasWildcards || nodes.at(failureNode).firstRule >= 0) ? failureNode : nodes.at(failureNode).outputNode);
+
+		for (int i = nodes.at(node).firstChild; i >= 0; i = nodes.at(i).nextSibling)
 		{
-			const bool supportsException(iterator.value() != WebSocketOption);
+			const QChar value(nodes.at(i).value);
+			int nextFailureNode(-1);
 
-			if (rule->ruleOptions.testFlag(iterator.value()) || (supportsException && rule->ruleOptions.testFlag(static_cast<RuleOption>(iterator.value() * 2))))
+			for (int j = failureNode; j >= 0; j = nodes.at(j).failureNode)
 			{
-				if (resourceType == iterator.key())
-				{
-					isBlocked = (isBlocked ? rule->ruleOptions.testFlag(iterator.value()) : isBlocked);
-				}
-				else if (supportsException)
-				{
-					isBlocked = (isBlocked ? rule->ruleOptions.testFlag(static_cast<RuleOption>(iterator.value() * 2)) : isBlocked);
-				}
-				else
+				nextFailureNode = findChild(rulesSet, j, value);
+
+				if (nextFailureNode >= 0)
 				{
-					isBlocked = false;
+					break;
 				}
 			}
+
+			nodes[i].failureNode = qMax(0, nextFailureNode);
+			nodes[i].depth = (nodes.at(node).depth + 1);
+
+			queue.enqueue(i);
 		}
 	}
+}
 
-	if (isBlocked)
+QString ContentBlockingProfile::createRulesSet(const QString &path, const QString &cachePath, int generation)
+{
+	QSharedPointer<RulesSet> rulesSet(new RulesSet());
+	QString errorString;
+
+	if (!loadCache(rulesSet.data(), path, cachePath))
 	{
-		ContentBlockingManager::CheckResult result;
-		result.rule = rule->rule;
+		QList<QStringList> chunks;
+		const QStringList lines(loadLines(path));
 
-		if (rule->isException)
+		for (int i = 0; i < lines.count(); i += 5000)
 		{
-			result.isBlocked = false;
-			result.isException = true;
+			chunks.append(lines.mid(i, 5000));
+		}
 
-			if (rule->ruleOptions.testFlag(ElementHideOption))
-			{
-				result.comesticFiltersMode = ContentBlockingManager::NoFiltersMode;
-			}
-			else if (rule->ruleOptions.testFlag(GenericHideOption))
-			{
-				result.comesticFiltersMode = ContentBlockingManager::DomainOnlyFiltersMode;
-			}
+		const QList<RulesChunk> parsedChunks(QtConcurrent::blockingMapped<QList<RulesChunk> >(chunks, &ContentBlockingProfile::parseRules));
 
-			return result;
+		rulesSet->nodes.append(Node());
+
+		for (int i = 0; i < parsedChunks.count(); ++i)
+		{
+			addRules(rulesSet.data(), parsedChunks.at(i));
 		}
 
-		result.isBlocked = true;
+		rulesSet->domainsIndexes.clear();
 
-		return result;
+		compileRules(rulesSet.data());
+
+		errorString = saveCache(rulesSet.data(), path, cachePath);
 	}
 
-	return ContentBlockingManager::CheckResult();
+	publishRulesSet(rulesSet, generation);
+
+	return errorString;
 }
 
-void ContentBlockingProfile::replyFinished()
+QString ContentBlockingProfile::updateRulesSet(const QSharedPointer<const RulesSet> &baseRulesSet, const QString &previousPath, const QString &path, const QString &cachePath, int generation)
 {
-	m_isUpdating = false;
+	const QStringList previousLines(loadLines(previousPath));
 
-	if (!m_networkReply)
-	{
-		return;
-	}
+	QFile::remove(previousPath);
 
-	m_networkReply->deleteLater();
+	const QStringList lines(loadLines(path));
+	const QSet<QString> previousLinesSet(previousLines.toSet());
+	const QSet<QString> linesSet(lines.toSet());
+	QStringList addedLines;
+	QStringList removedLines;
 
-	const QByteArray downloadedDataHeader(m_networkReply->readLine());
-	const QByteArray downloadedDataChecksum(m_networkReply->readLine());
-	const QByteArray downloadedData(m_networkReply->readAll());
+	for (int i = 0; i < lines.count(); ++i)
+	{
+		if (!previousLinesSet.contains(lines.at(i)))
+		{
+			addedLines.append(lines.at(i));
+		}
+	}
 
-	if (m_networkReply->error() != QNetworkReply::NoError || !downloadedDataHeader.trimmed().startsWith(QByteArray("[Adblock Plus")))
+	for (int i = 0; i < previousLines.count(); ++i)
 	{
-		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(m_networkReply->errorString()), Console::OtherCategory, Console::ErrorLevel, getPath());
+		if (!linesSet.contains(previousLines.at(i)))
+		{
+			removedLines.append(previousLines.at(i));
+		}
+	}
 
-		return;
+	if (addedLines.isEmpty() && removedLines.isEmpty())
+	{
+		return saveCache(baseRulesSet.data(), path, cachePath);
 	}
 
-	if (downloadedDataChecksum.contains(QByteArray("! Checksum: ")))
+	if ((addedLines.count() + removedLines.count()) > (lines.count() / 4))
 	{
-		QByteArray checksum(downloadedDataChecksum);
-		const QByteArray verifiedChecksum(QCryptographicHash::hash(downloadedDataHeader + QString(downloadedData).replace(QRegExp(QLatin1String("^*\n{2,}")), QLatin1String("\n")).toStdString().c_str(), QCryptographicHash::Md5));
+		return createRulesSet(path, cachePath, generation);
+	}
 
-		if (verifiedChecksum.toBase64().replace(QByteArray("="), QByteArray()) != checksum.replace(QByteArray("! Checksum: "), QByteArray()).replace(QByteArray("\n"), QByteArray()))
-		{
-			Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: checksum mismatch"), Console::OtherCategory, Console::ErrorLevel, getPath());
+	QSharedPointer<RulesSet> rulesSet(new RulesSet(*baseRulesSet));
 
-			return;
+	if (removedLines.isEmpty())
+	{
+		for (int i = 0; i < rulesSet->domains.count(); ++i)
+		{
+			rulesSet->domainsIndexes[rulesSet->domains.at(i)] = i;
 		}
 	}
+	else
+	{
+		removeRules(rulesSet.data(), parseRules(removedLines));
+		compactRules(rulesSet.data());
+	}
 
-	QDir().mkpath(SessionsManager::getWritableDataPath(QLatin1String("contentBlocking")));
+	addRules(rulesSet.data(), parseRules(addedLines));
 
-	QFile file(SessionsManager::getWritableDataPath(QLatin1String("contentBlocking/%1.txt")).arg(m_name));
+	rulesSet->domainsIndexes.clear();
 
-	if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate))
-	{
-		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(file.errorString()), Console::OtherCategory, Console::ErrorLevel, file.fileName());
+	compileRules(rulesSet.data());
 
-		return;
-	}
+	const QString errorString(saveCache(rulesSet.data(), path, cachePath));
 
-	file.write(downloadedDataHeader);
-	file.write(downloadedDataChecksum);
-	file.write(downloadedData);
-	file.close();
+	publishRulesSet(rulesSet, generation);
 
-	m_lastUpdate = QDateTime::currentDateTime();
+	return errorString;
+}
 
-	if (file.error() != QFile::NoError)
-	{
-// TODO
-	}
+void ContentBlockingProfile::buildRulesSet(int generation)
+{
+	m_mutex.lock();
 
-	clear();
-	loadHeader(getPath());
+	const bool isCurrent(generation == m_rulesSetGeneration);
+
+	m_mutex.unlock();
 
-	if (m_wasLoaded)
+	if (isCurrent)
 	{
-		loadRules();
+		watchRulesSet(QtConcurrent::run(&m_threadPool, this, &ContentBlockingProfile::createRulesSet, getPath(), getCachePath(), generation));
 	}
-
-	emit profileModified(m_name);
 }
 
-void ContentBlockingProfile::setUpdateInterval(int interval)
+void ContentBlockingProfile::watchRulesSet(const QFuture<QString> &future)
 {
-	if (interval != m_updateInterval)
-	{
-		m_updateInterval = interval;
+	QFutureWatcher<QString> *watcher(new QFutureWatcher<QString>(this));
 
-		emit profileModified(m_name);
-	}
+	connect(watcher, SIGNAL(finished()), this, SLOT(handleRulesSetFinished()));
+
+	watcher->setFuture(future);
 }
 
-void ContentBlockingProfile::setUpdateUrl(const QUrl &url)
+void ContentBlockingProfile::handleRulesSetFinished()
 {
-	if (url.isValid() && url != m_updateUrl)
+	QFutureWatcher<QString> *watcher(static_cast<QFutureWatcher<QString>*>(sender()));
+
+	if (!watcher)
 	{
-		m_updateUrl = url;
-		m_flags |= HasCustomUpdateUrlFlag;
+		return;
+	}
 
-		emit profileModified(m_name);
+	const QString errorString(watcher->result());
+
+	if (!errorString.isEmpty())
+	{
+		Console::addMessage(QCoreApplication::translate("main", "Failed to save content blocking profile cache: %1").arg(errorString), Console::OtherCategory, Console::WarningLevel, getCachePath());
 	}
+
+	watcher->deleteLater();
 }
 
-void ContentBlockingProfile::setCategory(const ProfileCategory &category)
+void ContentBlockingProfile::publishRulesSet(const QSharedPointer<RulesSet> &rulesSet, int generation)
 {
-	if (category != m_category)
+	rulesSet->nodes.squeeze();
+	rulesSet->rules.squeeze();
+	rulesSet->ruleDomains.squeeze();
+
+	m_mutex.lock();
+
+	const bool isCurrent(generation == m_rulesSetGeneration);
+
+	if (isCurrent)
 	{
-		m_category = category;
+		m_rulesSet = rulesSet;
+	}
 
-		emit profileModified(m_name);
+	m_mutex.unlock();
+
+	if (isCurrent)
+	{
+		ContentBlockingManager::clearCache();
 	}
 }
 
-void ContentBlockingProfile::setTitle(const QString &title)
+QSharedPointer<const ContentBlockingProfile::RulesSet> ContentBlockingProfile::getRulesSet()
 {
-	if (title != m_title)
-	{
-		m_title = title;
-		m_flags |= HasCustomTitleFlag;
+	QMutexLocker locker(&m_mutex);
 
-		emit profileModified(m_name);
+	if (!m_wasLoaded)
+	{
+		loadRules();
 	}
+
+	return m_rulesSet;
 }
 
-QString ContentBlockingProfile::getName() const
+ContentBlockingManager::CheckResult ContentBlockingProfile::checkUrlSubstring(const CheckContext &context, int node, int start, int position) const
+{
+	ContentBlockingManager::CheckResult result;
+	ContentBlockingManager::CheckResult currentResult;
+
+	for (int i = position; i < context.requestUrl.length(); ++i)
+	{
+		currentResult = evaluateRulesInNode(context, node, start, i);
+
+		if (currentResult.isBlocked)
+		{
+			result = currentResult;
+		}
+		else if (currentResult.isException)
+		{
+			return currentResult;
+		}
+
+		currentResult = checkWildcards(context, node, start, i);
+
+		if (currentResult.isBlocked)
+		{
+			result = currentResult;
+		}
+		else if (currentResult.isException)
+		{
+			return currentResult;
+		}
+
+		node = findChild(context.rulesSet, node, context.requestUrl.at(i));
+
+		if (node < 0)
+		{
+			return result;
+		}
+	}
+
+	currentResult = evaluateRulesInNode(context, node, start, context.requestUrl.length());
+
+	if (currentResult.isBlocked)
+	{
+		result = currentResult;
+	}
+	else if (currentResult.isException)
+	{
+		return currentResult;
+	}
+
+	return result;
+}
+
+ContentBlockingManager::CheckResult ContentBlockingProfile::checkWildcards(const CheckContext &context, int node, int start, int position) const
+{
+	ContentBlockingManager::CheckResult result;
+
+	if (!context.rulesSet->nodes.at(node).hasWildcards || position >= context.requestUrl.length())
+	{
+		return result;
+	}
+
+	const int separatorNode(isSeparator(context.requestUrl.at(position)) ? findChild(context.rulesSet, node, QLatin1Char('^')) : -1);
+
+	if (separatorNode >= 0)
+	{
+		const ContentBlockingManager::CheckResult currentResult(checkUrlSubstring(context, separatorNode, start, position));
+
+		if (currentResult.isBlocked)
+		{
+			result = currentResult;
+		}
+		else if (currentResult.isException)
+		{
+			return currentResult;
+		}
+	}
+
+	const int wildcardNode(findChild(context.rulesSet, node, QLatin1Char('*')));
+
+	if (wildcardNode >= 0)
+	{
+		for (int i = position; i < context.requestUrl.length(); ++i)
+		{
+			const ContentBlockingManager::CheckResult currentResult(checkUrlSubstring(context, wildcardNode, start, i));
+
+			if (currentResult.isBlocked)
+			{
+				result = currentResult;
+			}
+			else if (currentResult.isException)
+			{
+				return currentResult;
+			}
+		}
+	}
+
+	return result;
+}
+
+ContentBlockingManager::CheckResult ContentBlockingProfile::checkRuleMatch(const CheckContext &context, const ContentBlockingRule &rule, const QString &currentRule) const
+{
+	switch (rule.ruleMatch)
+	{
+		case StartMatch:
+			if (!context.requestUrl.startsWith(currentRule))
+			{
+				return ContentBlockingManager::CheckResult();
+			}
+
+			break;
+		case EndMatch:
+			if (!context.requestUrl.endsWith(currentRule))
+			{
+				return ContentBlockingManager::CheckResult();
+			}
+
+			break;
+		case ExactMatch:
+			if (context.requestUrl != currentRule)
+			{
+				return ContentBlockingManager::CheckResult();
+			}
+
+			break;
+		default:
+			if (!context.requestUrl.contains(currentRule))
+			{
+				return ContentBlockingManager::CheckResult();
+			}
+
+			break;
+	}
+
+	if (rule.needsDomainCheck)
+	{
+		int domainLength(0);
+
+		while (domainLength < currentRule.length() && !m_domainSeparators.contains(currentRule.at(domainLength)))
+		{
+			++domainLength;
+		}
+
+		if (!context.requestSubdomainList.contains(currentRule.left(domainLength)))
+		{
+			return ContentBlockingManager::CheckResult();
+		}
+	}
+
+	const bool hasBlockedDomains(rule.blockedDomainsAmount > 0);
+	const bool hasAllowedDomains(rule.allowedDomainsAmount > 0);
+	bool isBlocked(hasBlockedDomains ? resolveDomainExceptions(context.rulesSet, context.baseUrlHost, rule.blockedDomainsOffset, rule.blockedDomainsAmount) : true);
+	isBlocked = (hasAllowedDomains ? !resolveDomainExceptions(context.rulesSet, context.baseUrlHost, rule.allowedDomainsOffset, rule.allowedDomainsAmount) : isBlocked);
+
+	if (rule.ruleOptions.testFlag(ThirdPartyExceptionOption) || rule.ruleOptions.testFlag(ThirdPartyOption))
+	{
+		if (context.baseUrlHost.isEmpty() || context.requestSubdomainList.contains(context.baseUrlHost))
+		{
+			isBlocked = rule.ruleOptions.testFlag(ThirdPartyExceptionOption);
+		}
+		else if (!hasBlockedDomains && !hasAllowedDomains)
+		{
+			isBlocked = rule.ruleOptions.testFlag(ThirdPartyOption);
+		}
+	}
+
+	if (rule.ruleOptions != NoOption)
+	{
+		QHash<NetworkManager::ResourceType, RuleOption>::const_iterator iterator;
+
+		for (iterator = m_resourceTypes.begin(); iterator != m_resourceTypes.end(); ++iterator)
+		{
+			const bool supportsException(iterator.value() != WebSocketOption);
+
+			if (rule.ruleOptions.testFlag(iterator.value()) || (supportsException && rule.ruleOptions.testFlag(static_cast<RuleOption>(iterator.value() * 2))))
+			{
+				if (context.resourceType == iterator.key())
+				{
+					isBlocked = (isBlocked ? rule.ruleOptions.testFlag(iterator.value()) : isBlocked);
+				}
+				else if (supportsException)
+				{
+					isBlocked = (isBlocked ? rule.ruleOptions.testFlag(static_cast<RuleOption>(iterator.value() * 2)) : isBlocked);
+				}
+				else
+				{
+					isBlocked = false;
+				}
+			}
+		}
+	}
+
+	if (isBlocked)
+	{
+		ContentBlockingManager::CheckResult result;
+		result.rule = rule.rule;
+
+		if (rule.isException)
+		{
+			result.isBlocked = false;
+			result.isException = true;
+
+			if (rule.ruleOptions.testFlag(ElementHideOption))
+			{
+				result.comesticFiltersMode = ContentBlockingManager::NoFiltersMode;
+			}
+			else if (rule.ruleOptions.testFlag(GenericHideOption))
+			{
+				result.comesticFiltersMode = ContentBlockingManager::DomainOnlyFiltersMode;
+			}
+
+			return result;
+		}
+
+		result.isBlocked = true;
+
+		return result;
+	}
+
+	return ContentBlockingManager::CheckResult();
+}
+
+void ContentBlockingProfile::replyReadyRead()
+{
+	if (m_networkReply && m_downloadFile)
+	{
+		m_downloadFile->write(m_networkReply->readAll());
+	}
+}
+
+void ContentBlockingProfile::replyFinished()
+{
+	m_isUpdating = false;
+
+	if (!m_networkReply || !m_downloadFile)
+	{
+		return;
+	}
+
+	m_networkReply->deleteLater();
+	m_downloadFile->deleteLater();
+
+	QTemporaryFile *file(m_downloadFile);
+
+	m_downloadFile = nullptr;
+
+	if (m_networkReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304)
+	{
+		if (m_networkReply->hasRawHeader(QByteArray("ETag")))
+		{
+			m_entityTag = m_networkReply->rawHeader(QByteArray("ETag"));
+		}
+
+		m_lastUpdate = QDateTime::currentDateTime();
+
+		emit profileModified(m_name);
+
+		return;
+	}
+
+	file->write(m_networkReply->readAll());
+	file->seek(0);
+
+	const QByteArray downloadedDataHeader(file->readLine());
+	const QByteArray downloadedDataChecksum(file->readLine());
+
+	if (m_networkReply->error() != QNetworkReply::NoError || !downloadedDataHeader.trimmed().startsWith(QByteArray("[Adblock Plus")))
+	{
+		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(m_networkReply->errorString()), Console::OtherCategory, Console::ErrorLevel, getPath());
+
+		return;
+	}
+
+	if (downloadedDataChecksum.contains(QByteArray("! Checksum: ")))
+	{
+		QByteArray checksum(downloadedDataChecksum);
+		QCryptographicHash hash(QCryptographicHash::Md5);
+		bool hasLineBreak(false);
+
+		hash.addData(downloadedDataHeader);
+
+		while (!file->atEnd())
+		{
+			const QByteArray line(file->readLine());
+
+			if (hasLineBreak && line == QByteArray("\n"))
+			{
+				continue;
+			}
+
+			hash.addData(line);
+
+			hasLineBreak = line.endsWith('\n');
+		}
+
+		if (hash.result().toBase64().replace(QByteArray("="), QByteArray()) != checksum.replace(QByteArray("! Checksum: "), QByteArray()).replace(QByteArray("\n"), QByteArray()))
+		{
+			Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: checksum mismatch"), Console::OtherCategory, Console::ErrorLevel, getPath());
+
+			return;
+		}
+	}
+
+	m_mutex.lock();
+
+	const bool hasRulesSet(m_wasLoaded && m_rulesSet);
+
+	m_mutex.unlock();
+
+	const QString path(getPath());
+	const QString previousPath(path + QLatin1String(".previous"));
+
+	file->setAutoRemove(false);
+
+	QFile::remove(previousPath);
+
+	const bool hasPreviousLines(hasRulesSet && QFile::rename(path, previousPath));
+
+	if (!hasPreviousLines)
+	{
+		QFile::remove(path);
+	}
+
+	if (!file->rename(path))
+	{
+		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(file->errorString()), Console::OtherCategory, Console::ErrorLevel, path);
+
+		file->remove();
+
+		if (hasPreviousLines)
+		{
+			QFile::rename(previousPath, path);
+		}
+
+		return;
+	}
+
+	QFile::remove(getCachePath());
+
+	m_entityTag = m_networkReply->rawHeader(QByteArray("ETag"));
+	m_lastUpdate = QDateTime::currentDateTime();
+
+	loadHeader(path);
+
+	m_mutex.lock();
+
+	if (m_wasLoaded && m_rulesSet && hasPreviousLines)
+	{
+		++m_rulesSetGeneration;
+
+		watchRulesSet(QtConcurrent::run(&m_threadPool, this, &ContentBlockingProfile::updateRulesSet, m_rulesSet, previousPath, path, getCachePath(), m_rulesSetGeneration));
+	}
+	else
+	{
+		if (hasPreviousLines)
+		{
+			QFile::remove(previousPath);
+		}
+
+		if (m_wasLoaded)
+		{
+			loadRules();
+		}
+	}
+
+	m_mutex.unlock();
+
+	emit profileModified(m_name);
+}
+
+void ContentBlockingProfile::setUpdateInterval(int interval)
+{
+	if (interval != m_updateInterval)
+	{
+		m_updateInterval = interval;
+
+		emit profileModified(m_name);
+	}
+}
+
+void ContentBlockingProfile::setUpdateUrl(const QUrl &url)
+{
+	if (url.isValid() && url != m_updateUrl)
+	{
+		m_updateUrl = url;
+		m_entityTag.clear();
+		m_flags |= HasCustomUpdateUrlFlag;
+
+		emit profileModified(m_name);
+	}
+}
+
+void ContentBlockingProfile::setCategory(const ProfileCategory &category)
+{
+	if (category != m_category)
+	{
+		m_category = category;
+
+		emit profileModified(m_name);
+	}
+}
+
+void ContentBlockingProfile::setEntityTag(const QByteArray &entityTag)
+{
+	m_entityTag = entityTag;
+}
+
+void ContentBlockingProfile::setTitle(const QString &title)
+{
+	if (title != m_title)
+	{
+		m_title = title;
+		m_flags |= HasCustomTitleFlag;
+
+		emit profileModified(m_name);
+	}
+}
+
+QString ContentBlockingProfile::getName() const
 {
 	return m_name;
 }
@@ -702,6 +1211,11 @@ QString ContentBlockingProfile::getPath() const
 	return SessionsManager::getWritableDataPath(QLatin1String("contentBlocking/%1.txt")).arg(m_name);
 }
 
+QString ContentBlockingProfile::getCachePath() const
+{
+	return SessionsManager::getWritableDataPath(QLatin1String("contentBlocking/%1.dat")).arg(m_name);
+}
+
 QDateTime ContentBlockingProfile::getLastUpdate() const
 {
 	return m_lastUpdate;
@@ -712,35 +1226,112 @@ QUrl ContentBlockingProfile::getUpdateUrl() const
 	return m_updateUrl;
 }
 
+QByteArray ContentBlockingProfile::getEntityTag() const
+{
+	return m_entityTag;
+}
+
 ContentBlockingManager::CheckResult ContentBlockingProfile::checkUrl(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType)
 {
 	ContentBlockingManager::CheckResult result;
+	const QSharedPointer<const RulesSet> rulesSet(getRulesSet());
 
-	if (!m_wasLoaded && !loadRules())
+	if (!rulesSet)
 	{
 		return result;
 	}
 
-	m_baseUrlHost = baseUrl.host();
-	m_requestUrl = requestUrl.url();
-	m_requestHost = requestUrl.host();
+	CheckContext context;
+	context.rulesSet = rulesSet.data();
+	context.baseUrlHost = baseUrl.host();
+	context.requestUrl = requestUrl.url();
+	context.requestHost = requestUrl.host();
+	context.requestSubdomainList = ContentBlockingManager::createSubdomainList(context.requestHost);
+	context.resourceType = resourceType;
 
-	if (m_requestUrl.startsWith(QLatin1String("//")))
+	if (context.requestUrl.startsWith(QLatin1String("//")))
 	{
-		m_requestUrl = m_requestUrl.mid(2);
+		context.requestUrl = context.requestUrl.mid(2);
 	}
 
-	for (int i = 0; i < m_requestUrl.length(); ++i)
+	m_checkedRequests.fetchAndAddRelaxed(1);
+
+	if (!rulesSet->hostRules.isEmpty())
 	{
-		ContentBlockingManager::CheckResult currentResult(checkUrlSubstring(m_root, m_requestUrl.right(m_requestUrl.length() - i), QString(), resourceType));
+		for (int i = 0; i < context.requestSubdomainList.count(); ++i)
+		{
+			int rule(rulesSet->hostRules.value(context.requestSubdomainList.at(i), -1));
 
-		if (currentResult.isBlocked)
+			while (rule >= 0)
+			{
+				const ContentBlockingManager::CheckResult currentResult(checkRuleMatch(context, rulesSet->rules.at(rule), context.requestSubdomainList.at(i)));
+
+				if (currentResult.isBlocked)
+				{
+					result = currentResult;
+				}
+				else if (currentResult.isException)
+				{
+					m_hostIndexSettledRequests.fetchAndAddRelaxed(1);
+
+					return currentResult;
+				}
+
+				rule = rulesSet->rules.at(rule).nextRule;
+			}
+		}
+
+		if (result.isBlocked && !rulesSet->hasExceptionRules)
 		{
-			result = currentResult;
+			m_hostIndexSettledRequests.fetchAndAddRelaxed(1);
+
+			return result;
 		}
-		else if (currentResult.isException)
+	}
+
+	const QVector<Node> &nodes(rulesSet->nodes);
+	int node(0);
+
+	for (int i = 0; i <= context.requestUrl.length(); ++i)
+	{
+		if (i > 0)
 		{
-			return currentResult;
+			const QChar value(context.requestUrl.at(i - 1));
+			int nextNode(findChild(context.rulesSet, node, value));
+
+			while (nextNode < 0 && node > 0)
+			{
+				node = nodes.at(node).failureNode;
+				nextNode = findChild(context.rulesSet, node, value);
+			}
+
+			node = qMax(0, nextNode);
+		}
+
+		for (int matchedNode((nodes.at(node).hasWildcards || nodes.at(node).firstRule >= 0) ? node : nodes.at(node).outputNode); matchedNode >= 0; matchedNode = nodes.at(matchedNode).outputNode)
+		{
+			const int start(i - nodes.at(matchedNode).depth);
+			ContentBlockingManager::CheckResult currentResult(evaluateRulesInNode(context, matchedNode, start, i));
+
+			if (currentResult.isBlocked)
+			{
+				result = currentResult;
+			}
+			else if (currentResult.isException)
+			{
+				return currentResult;
+			}
+
+			currentResult = checkWildcards(context, matchedNode, start, i);
+
+			if (currentResult.isBlocked)
+			{
+				result = currentResult;
+			}
+			else if (currentResult.isException)
+			{
+				return currentResult;
+			}
 		}
 	}
 
@@ -749,32 +1340,28 @@ ContentBlockingManager::CheckResult ContentBlockingProfile::checkUrl(const QUrl
 
 QStringList ContentBlockingProfile::getStyleSheet()
 {
-	if (!m_wasLoaded)
-	{
-		loadRules();
-	}
+	const QSharedPointer<const RulesSet> rulesSet(getRulesSet());
 
-	return m_styleSheet;
+	return (rulesSet ? rulesSet->styleSheet : QStringList());
 }
 
-QStringList ContentBlockingProfile::getStyleSheetBlackList(const QString &domain)
+ContentBlockingManager::CosmeticFiltersResult ContentBlockingProfile::getCosmeticFilters(const QStringList &domains)
 {
-	if (!m_wasLoaded)
+	const QSharedPointer<const RulesSet> rulesSet(getRulesSet());
+	ContentBlockingManager::CosmeticFiltersResult result;
+
+	if (!rulesSet)
 	{
-		loadRules();
+		return result;
 	}
 
-	return m_styleSheetBlackList.values(domain);
-}
-
-QStringList ContentBlockingProfile::getStyleSheetWhiteList(const QString &domain)
-{
-	if (!m_wasLoaded)
+	for (int i = 0; i < domains.count(); ++i)
 	{
-		loadRules();
+		result.rules.append(rulesSet->styleSheetBlackList.values(domains.at(i)));
+		result.exceptions.append(rulesSet->styleSheetWhiteList.values(domains.at(i)));
 	}
 
-	return m_styleSheetWhiteList.values(domain);
+	return result;
 }
 
 QVector<QLocale::Language> ContentBlockingProfile::getLanguages() const
@@ -792,6 +1379,15 @@ ContentBlockingProfile::ProfileFlags ContentBlockingProfile::getFlags() const
 	return m_flags;
 }
 
+ContentBlockingProfile::CheckStatistics ContentBlockingProfile::getStatistics() const
+{
+	CheckStatistics statistics;
+	statistics.checkedRequests = m_checkedRequests.load();
+	statistics.hostIndexSettledRequests = m_hostIndexSettledRequests.load();
+
+	return statistics;
+}
+
 int ContentBlockingProfile::getUpdateInterval() const
 {
 	return m_updateInterval;
@@ -820,11 +1416,36 @@ bool ContentBlockingProfile::downloadRules()
 		return false;
 	}
 
+	QDir().mkpath(SessionsManager::getWritableDataPath(QLatin1String("contentBlocking")));
+
+	m_downloadFile = new QTemporaryFile(getPath(), this);
+
+	if (!m_downloadFile->open())
+	{
+		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(m_downloadFile->errorString()), Console::OtherCategory, Console::ErrorLevel, getPath());
+
+		m_downloadFile->deleteLater();
+		m_downloadFile = nullptr;
+
+		return false;
+	}
+
 	QNetworkRequest request(m_updateUrl);
 	request.setHeader(QNetworkRequest::UserAgentHeader, NetworkManagerFactory::getUserAgent());
 
+	if (!m_isEmpty && m_lastUpdate.isValid() && QFile::exists(getPath()))
+	{
+		request.setRawHeader(QByteArray("If-Modified-Since"), QLocale::c().toString(m_lastUpdate.toUTC(), QLatin1String("ddd, dd MMM yyyy hh:mm:ss 'GMT'")).toLatin1());
+
+		if (!m_entityTag.isEmpty())
+		{
+			request.setRawHeader(QByteArray("If-None-Match"), m_entityTag);
+		}
+	}
+
 	m_networkReply = NetworkManagerFactory::getNetworkManager()->get(request);
 
+	connect(m_networkReply, SIGNAL(readyRead()), this, SLOT(replyReadyRead()));
 	connect(m_networkReply, SIGNAL(finished()), this, SLOT(replyFinished()));
 
 	m_isUpdating = true;
@@ -832,61 +1453,274 @@ bool ContentBlockingProfile::downloadRules()
 	return true;
 }
 
-ContentBlockingManager::CheckResult ContentBlockingProfile::evaluateRulesInNode(Node *node, const QString &currentRule, NetworkManager::ResourceType resourceType) const
+ContentBlockingManager::CheckResult ContentBlockingProfile::evaluateRulesInNode(const CheckContext &context, int node, int start, int position) const
 {
 	ContentBlockingManager::CheckResult result;
+	int rule(context.rulesSet->nodes.at(node).firstRule);
 
-	for (int i = 0; i < node->rules.count(); ++i)
+	if (rule < 0)
 	{
-		if (node->rules.at(i))
-		{
-			ContentBlockingManager::CheckResult currentResult(checkRuleMatch(node->rules.at(i), currentRule, resourceType));
+		return result;
+	}
 
-			if (currentResult.isBlocked)
-			{
-				result = currentResult;
-			}
-			else if (currentResult.isException)
-			{
-				return currentResult;
-			}
+	const QString currentRule(context.requestUrl.mid(start, (position - start)));
+
+	while (rule >= 0)
+	{
+		const ContentBlockingManager::CheckResult currentResult(checkRuleMatch(context, context.rulesSet->rules.at(rule), currentRule));
+
+		if (currentResult.isBlocked)
+		{
+			result = currentResult;
+		}
+		else if (currentResult.isException)
+		{
+			return currentResult;
 		}
+
+		rule = context.rulesSet->rules.at(rule).nextRule;
 	}
 
 	return result;
 }
 
-bool ContentBlockingProfile::loadRules()
+QStringList ContentBlockingProfile::loadLines(const QString &path)
 {
-	if (m_isEmpty && !m_updateUrl.isEmpty())
+	QStringList lines;
+	QFile file(path);
+
+	if (file.open(QIODevice::ReadOnly | QIODevice::Text))
 	{
-		downloadRules();
+		QTextStream stream(&file);
+		stream.readLine(); // header
+
+		while (!stream.atEnd())
+		{
+			lines.append(stream.readLine());
+		}
+
+		file.close();
+	}
+
+	return lines;
+}
+
+ContentBlockingProfile::RulesChunk ContentBlockingProfile::parseRules(const QStringList &lines)
+{
+	RulesChunk chunk;
+
+	for (int i = 0; i < lines.count(); ++i)
+	{
+		parseRuleLine(lines.at(i), &chunk);
+	}
+
+	return chunk;
+}
+
+bool ContentBlockingProfile::checkRulesChain(const RulesSet *rulesSet, int firstRule, QVector<bool> *visitedRules)
+{
+	for (int i = firstRule; i >= 0; i = rulesSet->rules.at(i).nextRule)
+	{
+		if (visitedRules->at(i))
+		{
+			return false;
+		}
+
+		(*visitedRules)[i] = true;
+	}
+
+	return true;
+}
+
+bool ContentBlockingProfile::loadCache(RulesSet *rulesSet, const QString &path, const QString &cachePath)
+{
+	QFile file(cachePath);
 
+	if (!file.open(QIODevice::ReadOnly))
+	{
 		return false;
 	}
 
-	m_wasLoaded = true;
+	const QFileInfo sourceInformation(path);
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_4);
+	quint32 magic(0);
+	quint32 version(0);
+	qint64 sourceSize(0);
+	qint64 sourceModificationTime(0);
+	quint8 cosmeticFiltersMode(0);
+	bool areWildcardsEnabled(false);
+
+	stream >> magic >> version >> sourceSize >> sourceModificationTime >> cosmeticFiltersMode >> areWildcardsEnabled;
 
-	if (m_domainExpression.pattern().isEmpty())
+	if (stream.status() != QDataStream::Ok || magic != CacheMagic || version != CacheVersion || sourceSize != sourceInformation.size() || sourceModificationTime != sourceInformation.lastModified().toMSecsSinceEpoch() || cosmeticFiltersMode != static_cast<quint8>(ContentBlockingManager::getCosmeticFiltersMode()) || areWildcardsEnabled != ContentBlockingManager::areWildcardsEnabled())
 	{
-		m_domainExpression = QRegularExpression(QLatin1String("[:\?&/=]"));
-		m_domainExpression.optimize();
+		return false;
 	}
 
-	QFile file(getPath());
-	file.open(QIODevice::ReadOnly | QIODevice::Text);
+	qint32 rulesAmount(0);
 
-	QTextStream stream(&file);
-	stream.readLine(); // header
+	stream >> rulesSet->domains >> rulesSet->ruleDomains >> rulesSet->hostRules >> rulesSet->hasExceptionRules >> rulesAmount;
 
-	m_root = new Node();
+	bool isValid(stream.status() == QDataStream::Ok && rulesAmount >= 0);
 
-	while (!stream.atEnd())
+	if (isValid)
+	{
+		rulesSet->rules.resize(rulesAmount);
+
+		for (int i = 0; i < rulesAmount; ++i)
+		{
+			ContentBlockingRule &rule(rulesSet->rules[i]);
+			quint32 ruleOptions(NoOption);
+			quint8 ruleMatch(ContainsMatch);
+			qint32 blockedDomainsOffset(0);
+			qint32 blockedDomainsAmount(0);
+			qint32 allowedDomainsOffset(0);
+			qint32 allowedDomainsAmount(0);
+			qint32 nextRule(-1);
+
+			stream >> rule.rule >> ruleOptions >> ruleMatch >> blockedDomainsOffset >> blockedDomainsAmount >> allowedDomainsOffset >> allowedDomainsAmount >> nextRule >> rule.isException >> rule.needsDomainCheck;
+
+			rule.ruleOptions = static_cast<RuleOptions>(ruleOptions);
+			rule.ruleMatch = static_cast<RuleMatch>(qMin(ruleMatch, static_cast<quint8>(ExactMatch)));
+			rule.blockedDomainsOffset = blockedDomainsOffset;
+			rule.blockedDomainsAmount = blockedDomainsAmount;
+			rule.allowedDomainsOffset = allowedDomainsOffset;
+			rule.allowedDomainsAmount = allowedDomainsAmount;
+			rule.nextRule = nextRule;
+
+			if (blockedDomainsOffset < 0 || blockedDomainsAmount < 0 || (blockedDomainsOffset + blockedDomainsAmount) > rulesSet->ruleDomains.count() || allowedDomainsOffset < 0 || allowedDomainsAmount < 0 || (allowedDomainsOffset + allowedDomainsAmount) > rulesSet->ruleDomains.count() || nextRule >= rulesAmount)
+			{
+				isValid = false;
+
+				break;
+			}
+		}
+	}
+
+	qint32 nodesAmount(0);
+
+	if (isValid)
 	{
-		parseRuleLine(stream.readLine());
+		stream >> nodesAmount;
+
+		isValid = (stream.status() == QDataStream::Ok && nodesAmount > 0);
 	}
 
-	file.close();
+	if (isValid)
+	{
+		rulesSet->nodes.resize(nodesAmount);
+		rulesSet->edges.reserve(nodesAmount);
+
+		for (int i = 0; i < nodesAmount; ++i)
+		{
+			Node &node(rulesSet->nodes[i]);
+			quint16 value(0);
+			qint32 firstChild(-1);
+			qint32 nextSibling(-1);
+			qint32 firstRule(-1);
+			qint32 failureNode(-1);
+			qint32 outputNode(-1);
+			qint32 depth(0);
+
+			stream >> value >> firstChild >> nextSibling >> firstRule >> failureNode >> outputNode >> depth >> node.hasWildcards;
+
+			node.value = QChar(value);
+			node.firstChild = firstChild;
+			node.nextSibling = nextSibling;
+			node.firstRule = firstRule;
+			node.failureNode = failureNode;
+			node.outputNode = outputNode;
+			node.depth = depth;
+
+			if (firstChild >= nodesAmount || nextSibling >= nodesAmount || firstRule >= rulesAmount || failureNode >= nodesAmount || outputNode >= nodesAmount || depth < 0 || (i == 0 && depth > 0) || (i > 0 && failureNode < 0))
+			{
+				isValid = false;
+
+				break;
+			}
+		}
+	}
+
+	if (isValid)
+	{
+		QVector<bool> visitedRules(rulesAmount, false);
+
+		for (int i = 0; (isValid && i < nodesAmount); ++i)
+		{
+			const Node &node(rulesSet->nodes.at(i));
+
+			if ((node.failureNode >= 0 && rulesSet->nodes.at(node.failureNode).depth >= node.depth) || (node.outputNode >= 0 && rulesSet->nodes.at(node.outputNode).depth >= node.depth) || !checkRulesChain(rulesSet, node.firstRule, &visitedRules))
+			{
+				isValid = false;
+
+				break;
+			}
+
+			for (int j = node.firstChild; j >= 0; j = rulesSet->nodes.at(j).nextSibling)
+			{
+				const quint64 key(getEdgeKey(i, rulesSet->nodes.at(j).value));
+
+				if (rulesSet->nodes.at(j).depth != (node.depth + 1) || rulesSet->edges.contains(key))
+				{
+					isValid = false;
+
+					break;
+				}
+
+				rulesSet->edges.insert(key, j);
+			}
+		}
+
+		for (int i = 0; i < rulesSet->ruleDomains.count(); ++i)
+		{
+			if (rulesSet->ruleDomains.at(i) < 0 || rulesSet->ruleDomains.at(i) >= rulesSet->domains.count())
+			{
+				isValid = false;
+
+				break;
+			}
+		}
+
+		QHash<QString, int>::const_iterator iterator;
+
+		for (iterator = rulesSet->hostRules.constBegin(); iterator != rulesSet->hostRules.constEnd(); ++iterator)
+		{
+			if (iterator.value() < 0 || iterator.value() >= rulesAmount || !checkRulesChain(rulesSet, iterator.value(), &visitedRules))
+			{
+				isValid = false;
+
+				break;
+			}
+		}
+
+		stream >> rulesSet->styleSheet >> static_cast<QHash<QString, QString>&>(rulesSet->styleSheetBlackList) >> static_cast<QHash<QString, QString>&>(rulesSet->styleSheetWhiteList);
+	}
+
+	if (!isValid || stream.status() != QDataStream::Ok)
+	{
+		*rulesSet = RulesSet();
+
+		return false;
+	}
+
+	return true;
+}
+
+bool ContentBlockingProfile::loadRules()
+{
+	if (m_isEmpty && !m_updateUrl.isEmpty())
+	{
+		QMetaObject::invokeMethod(this, "downloadRules", Qt::QueuedConnection);
+
+		return false;
+	}
+
+	m_wasLoaded = true;
+
+	++m_rulesSetGeneration;
+
+	QMetaObject::invokeMethod(this, "buildRulesSet", Qt::QueuedConnection, Q_ARG(int, m_rulesSetGeneration));
 
 	return true;
 }
@@ -902,6 +1736,14 @@ bool ContentBlockingProfile::remove()
 		m_networkReply = nullptr;
 	}
 
+	if (m_downloadFile)
+	{
+		m_downloadFile->deleteLater();
+		m_downloadFile = nullptr;
+	}
+
+	QFile::remove(getCachePath());
+
 	if (QFile::exists(path))
 	{
 		return QFile::remove(path);
@@ -910,11 +1752,124 @@ bool ContentBlockingProfile::remove()
 	return true;
 }
 
-bool ContentBlockingProfile::resolveDomainExceptions(const QString &url, const QStringList &ruleList) const
+QStringList ContentBlockingProfile::getRuleDomains(const RulesSet *rulesSet, int offset, int amount)
+{
+	QStringList domains;
+	domains.reserve(amount);
+
+	for (int i = offset; i < (offset + amount); ++i)
+	{
+		domains.append(rulesSet->domains.at(rulesSet->ruleDomains.at(i)));
+	}
+
+	return domains;
+}
+
+QVector<ContentBlockingProfile::ContentBlockingRule> ContentBlockingProfile::collectRules(const RulesSet *rulesSet, RulesSet *compactedRulesSet, int firstRule)
+{
+	QVector<ContentBlockingRule> rules;
+
+	for (int i = firstRule; i >= 0; i = rulesSet->rules.at(i).nextRule)
+	{
+		ContentBlockingRule rule(rulesSet->rules.at(i));
+		rule.blockedDomainsOffset = addDomains(compactedRulesSet, getRuleDomains(rulesSet, rule.blockedDomainsOffset, rule.blockedDomainsAmount));
+		rule.allowedDomainsOffset = addDomains(compactedRulesSet, getRuleDomains(rulesSet, rule.allowedDomainsOffset, rule.allowedDomainsAmount));
+		rule.nextRule = -1;
+
+		rules.append(rule);
+	}
+
+	return rules;
+}
+
+bool ContentBlockingProfile::isLoading() const
+{
+	QMutexLocker locker(&m_mutex);
+
+	return (m_wasLoaded && !m_rulesSet);
+}
+
+int ContentBlockingProfile::removeRule(RulesSet *rulesSet, int firstRule, const QString &rule)
+{
+	int previousRule(-1);
+
+	for (int i = firstRule; i >= 0; i = rulesSet->rules.at(i).nextRule)
+	{
+		if (rulesSet->rules.at(i).rule == rule)
+		{
+			if (previousRule < 0)
+			{
+				return rulesSet->rules.at(i).nextRule;
+			}
+
+			rulesSet->rules[previousRule].nextRule = rulesSet->rules.at(i).nextRule;
+
+			break;
+		}
+
+		previousRule = i;
+	}
+
+	return firstRule;
+}
+
+int ContentBlockingProfile::addDomains(RulesSet *rulesSet, const QStringList &domains)
+{
+	const int offset(rulesSet->ruleDomains.count());
+
+	for (int i = 0; i < domains.count(); ++i)
+	{
+		int index(rulesSet->domainsIndexes.value(domains.at(i), -1));
+
+		if (index < 0)
+		{
+			index = rulesSet->domains.count();
+
+			rulesSet->domains.append(domains.at(i));
+			rulesSet->domainsIndexes[domains.at(i)] = index;
+		}
+
+		rulesSet->ruleDomains.append(index);
+	}
+
+	return offset;
+}
+
+int ContentBlockingProfile::findChild(const RulesSet *rulesSet, int node, const QChar &value)
+{
+	return rulesSet->edges.value(getEdgeKey(node, value), -1);
+}
+
+bool ContentBlockingProfile::isSeparator(const QChar &character)
+{
+	return (!character.isDigit() && !character.isLetter() && !m_separators.contains(character));
+}
+
+bool ContentBlockingProfile::isPlainHost(const QString &host)
+{
+	if (host.isEmpty())
+	{
+		return false;
+	}
+
+	for (int i = 0; i < host.length(); ++i)
+	{
+		const QChar character(host.at(i));
+
+		if (!character.isLetterOrNumber() && character != QLatin1Char('.') && character != QLatin1Char('-') && character != QLatin1Char('_'))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ContentBlockingProfile::resolveDomainExceptions(const RulesSet *rulesSet, const QString &url, int offset, int amount)
 {
-	for (int i = 0; i < ruleList.count(); ++i)
+	for (int i = offset; i < (offset + amount); ++i)
 	{
-		if (url.contains(ruleList.at(i)))
+		if (url.contains(rulesSet->domains.at(rulesSet->ruleDomains.at(i))))
 		{
 			return true;
 		}
@@ -923,4 +1878,9 @@ bool ContentBlockingProfile::resolveDomainExceptions(const QString &url, const Q
 	return false;
 }
 
+quint64 ContentBlockingProfile::getEdgeKey(int node, const QChar &value)
+{
+	return ((static_cast<quint64>(node) << 16) | value.unicode());
+}
+
 }
@@ -24,7 +24,12 @@
 
 #include "ContentBlockingManager.h"
 
-#include <QtCore/QRegularExpression>
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QThreadPool>
 
 namespace Otter
 {
@@ -53,10 +58,18 @@ public:
 		RegionalCategory = 16
 	};
 
+	struct CheckStatistics
+	{
+		quint64 checkedRequests = 0;
+		quint64 hostIndexSettledRequests = 0;
+	};
+
 	explicit ContentBlockingProfile(const QString &name, const QString &title, const QUrl &updateUrl, const QDateTime &lastUpdate, const QStringList &languages, int updateInterval, const ProfileCategory &category, const ProfileFlags &flags, QObject *parent = nullptr);
+	~ContentBlockingProfile();
 
 	void clear();
 	void setCategory(const ProfileCategory &category);
+	void setEntityTag(const QByteArray &entityTag);
 	void setTitle(const QString &title);
 	void setUpdateInterval(int interval);
 	void setUpdateUrl(const QUrl &url);
@@ -64,16 +77,18 @@ public:
 	QString getTitle() const;
 	QUrl getUpdateUrl() const;
 	QDateTime getLastUpdate() const;
+	QByteArray getEntityTag() const;
 	ContentBlockingManager::CheckResult checkUrl(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType);
 	QStringList getStyleSheet();
-	QStringList getStyleSheetBlackList(const QString &domain);
-	QStringList getStyleSheetWhiteList(const QString &domain);
+	ContentBlockingManager::CosmeticFiltersResult getCosmeticFilters(const QStringList &domains);
 	QVector<QLocale::Language> getLanguages() const;
 	ProfileCategory getCategory() const;
 	ProfileFlags getFlags() const;
+	CheckStatistics getStatistics() const;
 	int getUpdateInterval() const;
-	bool downloadRules();
+	Q_INVOKABLE bool downloadRules();
 	bool remove();
+	bool isLoading() const;
 
 protected:
 	enum RuleOption : quint32
@@ -102,6 +117,12 @@ protected:
 
 	Q_DECLARE_FLAGS(RuleOptions, RuleOption)
 
+	enum CacheFormat : quint32
+	{
+		CacheMagic = 0x4F43424C,
+		CacheVersion = 3
+	};
+
 	enum RuleMatch
 	{
 		ContainsMatch = 0,
@@ -113,63 +134,138 @@ protected:
 	struct ContentBlockingRule
 	{
 		QString rule;
-		QStringList blockedDomains;
-		QStringList allowedDomains;
 		RuleOptions ruleOptions = NoOption;
 		RuleMatch ruleMatch = ContainsMatch;
+		int blockedDomainsOffset = 0;
+		int blockedDomainsAmount = 0;
+		int allowedDomainsOffset = 0;
+		int allowedDomainsAmount = 0;
+		int nextRule = -1;
 		bool isException = false;
 		bool needsDomainCheck = false;
-
-		explicit ContentBlockingRule(QString ruleValue, QStringList blockedDomainsValue, QStringList allowedDomainsValue, RuleOptions ruleOptionsValue, RuleMatch ruleMatchValue, bool isExceptionValue, bool needsDomainCheckValue) : rule(ruleValue), blockedDomains(blockedDomainsValue), allowedDomains(allowedDomainsValue), ruleOptions(ruleOptionsValue), ruleMatch(ruleMatchValue), isException(isExceptionValue), needsDomainCheck(needsDomainCheckValue)
-		{
-		}
 	};
 
 	struct Node
 	{
 		QChar value = 0;
-		QVarLengthArray<Node*, 1> children;
-		QVarLengthArray<ContentBlockingRule*, 1> rules;
+		int firstChild = -1;
+		int nextSibling = -1;
+		int firstRule = -1;
+		int failureNode = -1;
+		int outputNode = -1;
+		int depth = 0;
+		bool hasWildcards = false;
+	};
+
+	struct RulesSet
+	{
+		QStringList domains;
+		QStringList styleSheet;
+		QVector<Node> nodes;
+		QVector<ContentBlockingRule> rules;
+		QVector<int> ruleDomains;
+		QHash<quint64, int> edges;
+		QHash<QString, int> hostRules;
+		QHash<QString, int> domainsIndexes;
+		QMultiHash<QString, QString> styleSheetBlackList;
+		QMultiHash<QString, QString> styleSheetWhiteList;
+		bool hasExceptionRules = false;
+	};
+
+	struct ParsedRule
+	{
+		ContentBlockingRule rule;
+		QString ruleString;
+		QStringList blockedDomains;
+		QStringList allowedDomains;
+		bool isHostRule = false;
+	};
+
+	struct RulesChunk
+	{
+		QStringList styleSheet;
+		QVector<ParsedRule> rules;
+		QMultiHash<QString, QString> styleSheetBlackList;
+		QMultiHash<QString, QString> styleSheetWhiteList;
+	};
+
+	struct CheckContext
+	{
+		const RulesSet *rulesSet = nullptr;
+		QString requestUrl;
+		QString requestHost;
+		QString baseUrlHost;
+		QStringList requestSubdomainList;
+		NetworkManager::ResourceType resourceType = NetworkManager::OtherType;
 	};
 
 	QString getPath() const;
+	QString getCachePath() const;
 	void loadHeader(const QString &path);
-	void parseRuleLine(QString line);
-	void parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list) const;
-	void addRule(ContentBlockingRule *rule, const QString &ruleString) const;
-	void deleteNode(Node *node) const;
-	ContentBlockingManager::CheckResult checkUrlSubstring(Node *node, const QString &subString, QString currentRule, NetworkManager::ResourceType resourceType);
-	ContentBlockingManager::CheckResult checkRuleMatch(ContentBlockingRule *rule, const QString &currentRule, NetworkManager::ResourceType resourceType) const;
-	ContentBlockingManager::CheckResult evaluateRulesInNode(Node *node, const QString &currentRule, NetworkManager::ResourceType resourceType) const;
+	void watchRulesSet(const QFuture<QString> &future);
+	void publishRulesSet(const QSharedPointer<RulesSet> &rulesSet, int generation);
+	QString createRulesSet(const QString &path, const QString &cachePath, int generation);
+	QString updateRulesSet(const QSharedPointer<const RulesSet> &baseRulesSet, const QString &previousPath, const QString &path, const QString &cachePath, int generation);
+	QSharedPointer<const RulesSet> getRulesSet();
+	ContentBlockingManager::CheckResult checkUrlSubstring(const CheckContext &context, int node, int start, int position) const;
+	ContentBlockingManager::CheckResult checkWildcards(const CheckContext &context, int node, int start, int position) const;
+	ContentBlockingManager::CheckResult checkRuleMatch(const CheckContext &context, const ContentBlockingRule &rule, const QString &currentRule) const;
+	ContentBlockingManager::CheckResult evaluateRulesInNode(const CheckContext &context, int node, int start, int position) const;
 	bool loadRules();
-	bool resolveDomainExceptions(const QString &url, const QStringList &ruleList) const;
+
+	static void parseRuleLine(QString line, RulesChunk *chunk);
+	static void parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list);
+	static void addRules(RulesSet *rulesSet, const RulesChunk &chunk);
+	static void removeRules(RulesSet *rulesSet, const RulesChunk &chunk);
+	static void compactRules(RulesSet *rulesSet);
+	static void addRule(RulesSet *rulesSet, ContentBlockingRule rule, const QString &ruleString);
+	static void addHostRule(RulesSet *rulesSet, ContentBlockingRule rule, const QString &host);
+	static void compileRules(RulesSet *rulesSet);
+	static quint64 getEdgeKey(int node, const QChar &value);
+	static QString saveCache(const RulesSet *rulesSet, const QString &path, const QString &cachePath);
+	static QStringList loadLines(const QString &path);
+	static QStringList getRuleDomains(const RulesSet *rulesSet, int offset, int amount);
+	static QVector<ContentBlockingRule> collectRules(const RulesSet *rulesSet, RulesSet *compactedRulesSet, int firstRule);
+	static int removeRule(RulesSet *rulesSet, int firstRule, const QString &rule);
+	static int addDomains(RulesSet *rulesSet, const QStringList &domains);
+	static int findChild(const RulesSet *rulesSet, int node, const QChar &value);
+	static RulesChunk parseRules(const QStringList &lines);
+	static bool loadCache(RulesSet *rulesSet, const QString &path, const QString &cachePath);
+	static bool checkRulesChain(const RulesSet *rulesSet, int firstRule, QVector<bool> *visitedRules);
+	static bool isSeparator(const QChar &character);
+	static bool isPlainHost(const QString &host);
+	static bool resolveDomainExceptions(const RulesSet *rulesSet, const QString &url, int offset, int amount);
 
 protected slots:
+	void buildRulesSet(int generation);
+	void replyReadyRead();
 	void replyFinished();
+	void handleRulesSetFinished();
 
 private:
-	Node *m_root;
 	QNetworkReply *m_networkReply;
-	QString m_requestUrl;
-	QString m_requestHost;
-	QString m_baseUrlHost;
+	QTemporaryFile *m_downloadFile;
 	QString m_name;
 	QString m_title;
 	QUrl m_updateUrl;
 	QDateTime m_lastUpdate;
-	QRegularExpression m_domainExpression;
-	QStringList m_styleSheet;
+	QByteArray m_entityTag;
+	QSharedPointer<const RulesSet> m_rulesSet;
+	QThreadPool m_threadPool;
 	QVector<QLocale::Language> m_languages;
-	QMultiHash<QString, QString> m_styleSheetBlackList;
-	QMultiHash<QString, QString> m_styleSheetWhiteList;
+	mutable QMutex m_mutex;
+	QAtomicInteger<quint64> m_checkedRequests;
+	QAtomicInteger<quint64> m_hostIndexSettledRequests;
 	ProfileCategory m_category;
 	ProfileFlags m_flags;
+	int m_rulesSetGeneration;
 	int m_updateInterval;
 	bool m_isUpdating;
 	bool m_isEmpty;
 	bool m_wasLoaded;
 
 	static QVector<QChar> m_separators;
+	static QVector<QChar> m_domainSeparators;
 	static QHash<QString, RuleOption> m_options;
 	static QHash<NetworkManager::ResourceType, RuleOption> m_resourceTypes;
 
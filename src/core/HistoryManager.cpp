@@ -20,7 +20,6 @@
 
 #include "HistoryManager.h"
 #include "AddonsManager.h"
-#include "Application.h"
 #include "SessionsManager.h"
 #include "SettingsManager.h"
 #include "ThemesManager.h"
@@ -36,10 +35,9 @@ HistoryModel* HistoryManager::m_typedHistoryModel(nullptr);
 bool HistoryManager::m_isEnabled(false);
 bool HistoryManager::m_isStoringFavicons(true);
 
-HistoryManager::HistoryManager(QObject *parent) : QObject(parent),
-	m_saveTimer(0)
+HistoryManager::HistoryManager(QObject *parent) : QObject(parent)
 {
-	m_dayTimer = startTimer(QTime::currentTime().msecsTo(QTime(23, 59, 59, 999)));
+	m_dayTimer = startTimer((QTime::currentTime().msecsTo(QTime(23, 59, 59, 999)) + 1000), Qt::PreciseTimer);
 
 	handleOptionChanged(SettingsManager::History_RememberBrowsingOption);
 	handleOptionChanged(SettingsManager::History_StoreFaviconsOption);
@@ -57,15 +55,7 @@ void HistoryManager::createInstance()
 
 void HistoryManager::timerEvent(QTimerEvent *event)
 {
-	if (event->timerId() == m_saveTimer)
-	{
-		killTimer(m_saveTimer);
-
-		m_saveTimer = 0;
-
-		save();
-	}
-	else if (event->timerId() == m_dayTimer)
+	if (event->timerId() == m_dayTimer)
 	{
 		killTimer(m_dayTimer);
 
@@ -84,32 +74,9 @@ void HistoryManager::timerEvent(QTimerEvent *event)
 		m_browsingHistoryModel->clearOldestEntries(period);
 		m_typedHistoryModel->clearOldestEntries(period);
 
-		scheduleSave();
-
 		emit dayChanged();
 
-		m_dayTimer = startTimer(QTime::currentTime().msecsTo(QTime(23, 59, 59, 999)));
-	}
-}
-
-void HistoryManager::scheduleSave()
-{
-	if (m_saveTimer == 0)
-	{
-		m_saveTimer = startTimer(1000);
-	}
-}
-
-void HistoryManager::save()
-{
-	if (m_browsingHistoryModel)
-	{
-		m_browsingHistoryModel->save(SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.json")));
-	}
-
-	if (m_typedHistoryModel)
-	{
-		m_typedHistoryModel->save(SessionsManager::getWritableDataPath(QLatin1String("typedHistory.json")));
+		m_dayTimer = startTimer((QTime::currentTime().msecsTo(QTime(23, 59, 59, 999)) + 1000), Qt::PreciseTimer);
 	}
 }
 
@@ -127,15 +94,6 @@ void HistoryManager::clearHistory(uint period)
 
 	m_browsingHistoryModel->clearRecentEntries(period);
 	m_typedHistoryModel->clearRecentEntries(period);
-
-	if (Application::isAboutToQuit())
-	{
-		m_instance->save();
-	}
-	else
-	{
-		m_instance->scheduleSave();
-	}
 }
 
 void HistoryManager::removeEntry(quint64 identifier)
@@ -151,8 +109,6 @@ void HistoryManager::removeEntry(quint64 identifier)
 	}
 
 	m_browsingHistoryModel->removeEntry(identifier);
-
-	m_instance->scheduleSave();
 }
 
 void HistoryManager::removeEntries(const QVector<quint64> &identifiers)
@@ -167,12 +123,7 @@ void HistoryManager::removeEntries(const QVector<quint64> &identifiers)
 		getBrowsingHistoryModel();
 	}
 
-	for (int i = 0; i < identifiers.count(); ++i)
-	{
-		m_browsingHistoryModel->removeEntry(identifiers.at(i));
-	}
-
-	m_instance->scheduleSave();
+	m_browsingHistoryModel->removeEntries(identifiers);
 }
 
 void HistoryManager::updateEntry(quint64 identifier, const QUrl &url, const QString &title, const QIcon &icon)
@@ -194,16 +145,7 @@ void HistoryManager::updateEntry(quint64 identifier, const QUrl &url, const QStr
 		getBrowsingHistoryModel();
 	}
 
-	HistoryEntryItem *item(m_browsingHistoryModel->getEntry(identifier));
-
-	if (item)
-	{
-		item->setData(url, HistoryModel::UrlRole);
-		item->setData(title, HistoryModel::TitleRole);
-		item->setIcon(icon);
-	}
-
-	m_instance->scheduleSave();
+	m_browsingHistoryModel->updateEntry(identifier, url, title, icon);
 }
 
 void HistoryManager::handleOptionChanged(int identifier)
@@ -231,8 +173,6 @@ void HistoryManager::handleOptionChanged(int identifier)
 
 				m_browsingHistoryModel->clearExcessEntries(limit);
 				m_typedHistoryModel->clearExcessEntries(limit);
-
-				scheduleSave();
 			}
 
 			break;
@@ -252,8 +192,6 @@ void HistoryManager::handleOptionChanged(int identifier)
 
 				m_browsingHistoryModel->clearOldestEntries(period);
 				m_typedHistoryModel->clearOldestEntries(period);
-
-				scheduleSave();
 			}
 
 			break;
@@ -266,6 +204,19 @@ void HistoryManager::handleOptionChanged(int identifier)
 	}
 }
 
+void HistoryManager::handleModelLoaded()
+{
+	HistoryModel *model(qobject_cast<HistoryModel*>(sender()));
+
+	if (model)
+	{
+		model->clearOldestEntries(SettingsManager::getOption(SettingsManager::History_BrowsingLimitPeriodOption).toInt());
+		model->clearExcessEntries(SettingsManager::getOption(SettingsManager::History_BrowsingLimitAmountGlobalOption).toInt());
+	}
+
+	emit historyLoaded();
+}
+
 HistoryManager* HistoryManager::getInstance()
 {
 	return m_instance;
@@ -275,7 +226,12 @@ HistoryModel* HistoryManager::getBrowsingHistoryModel()
 {
 	if (!m_browsingHistoryModel)
 	{
-		m_browsingHistoryModel = new HistoryModel(SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.json")), HistoryModel::BrowsingHistory, m_instance);
+		m_browsingHistoryModel = new HistoryModel(SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.dat")), HistoryModel::BrowsingHistory, m_instance);
+
+		if (m_instance)
+		{
+			connect(m_browsingHistoryModel, SIGNAL(loaded()), m_instance, SLOT(handleModelLoaded()));
+		}
 	}
 
 	return m_browsingHistoryModel;
@@ -285,7 +241,9 @@ HistoryModel* HistoryManager::getTypedHistoryModel()
 {
 	if (!m_typedHistoryModel && m_instance)
 	{
-		m_typedHistoryModel = new HistoryModel(SessionsManager::getWritableDataPath(QLatin1String("typedHistory.json")), HistoryModel::TypedHistory, m_instance);
+		m_typedHistoryModel = new HistoryModel(SessionsManager::getWritableDataPath(QLatin1String("typedHistory.dat")), HistoryModel::TypedHistory, m_instance);
+
+		connect(m_typedHistoryModel, SIGNAL(loaded()), m_instance, SLOT(handleModelLoaded()));
 	}
 
 	return m_typedHistoryModel;
@@ -318,7 +276,7 @@ QIcon HistoryManager::getIcon(const QUrl &url)
 	return ThemesManager::createIcon(QLatin1String("text-html"));
 }
 
-HistoryEntryItem* HistoryManager::getEntry(quint64 identifier)
+HistoryModel::HistoryEntry HistoryManager::getEntry(quint64 identifier)
 {
 	if (!m_browsingHistoryModel)
 	{
@@ -328,7 +286,7 @@ HistoryEntryItem* HistoryManager::getEntry(quint64 identifier)
 	return m_browsingHistoryModel->getEntry(identifier);
 }
 
-QVector<HistoryModel::HistoryEntryMatch> HistoryManager::findEntries(const QString &prefix, bool isTypedInOnly)
+QVector<HistoryModel::HistoryEntryMatch> HistoryManager::findEntries(const QString &prefix, bool isTypedInOnly, int limit)
 {
 	if (!m_typedHistoryModel)
 	{
@@ -340,15 +298,20 @@ QVector<HistoryModel::HistoryEntryMatch> HistoryManager::findEntries(const QStri
 		getBrowsingHistoryModel();
 	}
 
-	QVector<HistoryModel::HistoryEntryMatch> entries(m_typedHistoryModel->findEntries(prefix, true));
+	QVector<HistoryModel::HistoryEntryMatch> entries(m_typedHistoryModel->findEntries(prefix, true, limit));
 
 	if (!isTypedInOnly)
 	{
 #if QT_VERSION >= 0x050500
-		entries.append(m_browsingHistoryModel->findEntries(prefix));
+		entries.append(m_browsingHistoryModel->findEntries(prefix, false, limit));
 #else
-		entries += m_browsingHistoryModel->findEntries(prefix);
+		entries += m_browsingHistoryModel->findEntries(prefix, false, limit);
 #endif
+
+		if (limit >= 0 && entries.count() > limit)
+		{
+			entries.resize(limit);
+		}
 	}
 
 	return entries;
@@ -366,7 +329,7 @@ quint64 HistoryManager::addEntry(const QUrl &url, const QString &title, const QI
 		getBrowsingHistoryModel();
 	}
 
-	const quint64 identifier(m_browsingHistoryModel->addEntry(url, title, icon, QDateTime::currentDateTime())->data(HistoryModel::IdentifierRole).toULongLong());
+	const quint64 identifier(m_browsingHistoryModel->addEntry(url, title, icon, QDateTime::currentDateTime()));
 
 	if (isTypedIn)
 	{
@@ -378,17 +341,7 @@ quint64 HistoryManager::addEntry(const QUrl &url, const QString &title, const QI
 		m_typedHistoryModel->addEntry(url, title, icon, QDateTime::currentDateTime());
 	}
 
-	const int limit(SettingsManager::getOption(SettingsManager::History_BrowsingLimitAmountGlobalOption).toInt());
-
-	if (limit > 0 && m_browsingHistoryModel->rowCount() > limit)
-	{
-		for (int i = (m_browsingHistoryModel->rowCount() - 1); i >= limit; --i)
-		{
-			m_browsingHistoryModel->removeEntry(m_browsingHistoryModel->index(i, 0).data(HistoryModel::IdentifierRole).toULongLong());
-		}
-	}
-
-	m_instance->scheduleSave();
+	m_browsingHistoryModel->clearExcessEntries(SettingsManager::getOption(SettingsManager::History_BrowsingLimitAmountGlobalOption).toInt());
 
 	return identifier;
 }
@@ -43,8 +43,8 @@ public:
 	static HistoryModel* getBrowsingHistoryModel();
 	static HistoryModel* getTypedHistoryModel();
 	static QIcon getIcon(const QUrl &url);
-	static HistoryEntryItem* getEntry(quint64 identifier);
-	static QVector<HistoryModel::HistoryEntryMatch> findEntries(const QString &prefix, bool isTypedInOnly = false);
+	static HistoryModel::HistoryEntry getEntry(quint64 identifier);
+	static QVector<HistoryModel::HistoryEntryMatch> findEntries(const QString &prefix, bool isTypedInOnly = false, int limit = -1);
 	static quint64 addEntry(const QUrl &url, const QString &title, const QIcon &icon, bool isTypedIn = false);
 	static bool hasEntry(const QUrl &url);
 
@@ -52,15 +52,13 @@ protected:
 	explicit HistoryManager(QObject *parent);
 
 	void timerEvent(QTimerEvent *event) override;
-	void scheduleSave();
-	void save();
 
 protected slots:
 	void handleOptionChanged(int identifier);
+	void handleModelLoaded();
 
 private:
 	int m_dayTimer;
-	int m_saveTimer;
 
 	static HistoryManager *m_instance;
 	static HistoryModel *m_browsingHistoryModel;
@@ -70,6 +68,7 @@ private:
 
 signals:
 	void dayChanged();
+	void historyLoaded();
 };
 
 }
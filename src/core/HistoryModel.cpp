@@ -20,40 +20,54 @@
 
 #include "HistoryModel.h"
 #include "Console.h"
-#include "JsonSettings.h"
 #include "SessionsManager.h"
 #include "Utils.h"
 
-#include <QtCore/QFile>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
 #include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSet>
+
+#include <limits>
 
 namespace Otter
 {
 
-HistoryEntryItem::HistoryEntryItem() : QStandardItem()
+HistoryModel::HistoryModel(const QString &path, HistoryType type, QObject *parent) : QAbstractListModel(parent),
+	m_path(path),
+	m_compactionWatcher(nullptr),
+	m_segmentWatcher(nullptr),
+	m_nextIdentifier(1),
+	m_type(type),
+	m_journalRecords(0),
+	m_needsCompaction(false)
 {
-}
+	const QFileInfo information(path);
+	const QString legacyPath(information.absoluteDir().filePath(information.completeBaseName() + QLatin1String(".json")));
+	const bool needsMigration(!loadSnapshot(path) && QFile::exists(legacyPath));
 
-void HistoryEntryItem::setData(const QVariant &value, int role)
-{
-	if (model() && qobject_cast<HistoryModel*>(model()))
+	m_journalPath = information.absoluteDir().filePath(information.completeBaseName() + QLatin1String(".journal"));
+
+	if (needsMigration)
 	{
-		model()->setData(index(), value, role);
+		loadLegacyHistory(legacyPath);
 	}
-	else
+
+	replayJournal(m_journalPath + QLatin1String(".old"));
+	replayJournal(m_journalPath);
+
+	if (needsMigration)
 	{
-		QStandardItem::setData(value, role);
+		compact();
 	}
 }
 
-void HistoryEntryItem::setItemData(const QVariant &value, int role)
-{
-	QStandardItem::setData(value, role);
-}
-
-HistoryModel::HistoryModel(const QString &path, HistoryType type, QObject *parent) : QStandardItemModel(parent),
-	m_type(type)
+void HistoryModel::loadLegacyHistory(const QString &path)
 {
 	QFile file(path);
 
@@ -68,46 +82,226 @@ HistoryModel::HistoryModel(const QString &path, HistoryType type, QObject *paren
 
 	file.close();
 
+	m_times.reserve(historyArray.count());
+	m_identifiers.reserve(historyArray.count());
+	m_urls.reserve(historyArray.count());
+	m_titles.reserve(historyArray.count());
+
 	for (int i = 0; i < historyArray.count(); ++i)
 	{
 		const QJsonObject entryObject(historyArray.at(i).toObject());
+		const qint64 time(QDateTime::fromString(entryObject.value(QLatin1String("time")).toString(), QLatin1String("yyyy-MM-dd hh:mm:ss")).toMSecsSinceEpoch());
 
-		addEntry(QUrl(entryObject.value(QLatin1String("url")).toString()), entryObject.value(QLatin1String("title")).toString(), QIcon(), QDateTime::fromString(entryObject.value(QLatin1String("time")).toString(), QLatin1String("yyyy-MM-dd hh:mm:ss")));
+		insertEntry((std::upper_bound(m_times.constBegin(), m_times.constEnd(), time) - m_times.constBegin()), QUrl(entryObject.value(QLatin1String("url")).toString()), entryObject.value(QLatin1String("title")).toString(), time, m_nextIdentifier);
 	}
+}
+
+void HistoryModel::replayJournal(const QString &path)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_4);
+
+	while (!stream.atEnd())
+	{
+		quint8 type(UnknownRecord);
+		quint64 identifier(0);
+		qint64 time(0);
+		QUrl url;
+		QString title;
+		QVector<quint64> identifiers;
+
+		stream >> type;
+
+		switch (type)
+		{
+			case AddRecord:
+				stream >> identifier >> time >> url >> title;
+
+				break;
+			case UpdateRecord:
+				stream >> identifier >> url >> title;
+
+				break;
+			case RemoveRecord:
+				stream >> identifiers;
 
-	setSortRole(TimeVisitedRole);
-	sort(0, Qt::DescendingOrder);
+				break;
+			case ClearRecord:
+				break;
+			default:
+				stream.setStatus(QDataStream::ReadCorruptData);
+
+				break;
+		}
+
+		if (stream.status() != QDataStream::Ok)
+		{
+			Console::addMessage(tr("Failed to read history journal, last records were skipped"), Console::OtherCategory, Console::WarningLevel, path);
+
+			break;
+		}
+
+		++m_journalRecords;
+
+		switch (type)
+		{
+			case AddRecord:
+				if (!m_positions.contains(identifier))
+				{
+					insertEntry((std::upper_bound(m_times.constBegin(), m_times.constEnd(), time) - m_times.constBegin()), url, title, time, identifier);
+				}
+
+				break;
+			case UpdateRecord:
+				if (m_positions.contains(identifier))
+				{
+					const int position(m_positions.value(identifier));
+
+					setEntryUrl(position, url);
+
+					m_titlesPool.removeValue(m_titles.at(position));
+					m_titles[position] = m_titlesPool.addValue(title);
+				}
+
+				break;
+			case RemoveRecord:
+				removeIdentifiers(identifiers);
+
+				break;
+			case ClearRecord:
+				clearEntries();
+
+				break;
+			default:
+				break;
+		}
+	}
 }
 
-void HistoryModel::clearExcessEntries(int limit)
+void HistoryModel::writeRecord(const QByteArray &record)
 {
-	if (limit > 0 && rowCount() > limit)
+	if (m_path.isEmpty() || SessionsManager::isReadOnly())
 	{
-		for (int i = (rowCount() - 1); i >= limit; --i)
+		return;
+	}
+
+	if (!m_journalFile.isOpen())
+	{
+		m_journalFile.setFileName(m_journalPath);
+
+		if (!m_journalFile.open(QIODevice::WriteOnly | QIODevice::Append))
 		{
-			removeEntry(index(i, 0).data(HistoryModel::IdentifierRole).toULongLong());
+			Console::addMessage(tr("Failed to open history journal: %1").arg(m_journalFile.errorString()), Console::OtherCategory, Console::ErrorLevel, m_journalPath);
+
+			return;
 		}
 	}
+
+	m_journalFile.write(record);
+	m_journalFile.flush();
+
+	++m_journalRecords;
+
+	if (m_journalRecords > qMax(1000, (m_times.count() / 4)))
+	{
+		compact();
+	}
 }
 
-void HistoryModel::clearRecentEntries(uint period)
+void HistoryModel::compact()
 {
-	if (period == 0)
+	if (m_path.isEmpty() || SessionsManager::isReadOnly() || m_compactionWatcher)
 	{
-		clear();
+		return;
+	}
 
-		emit cleared();
+	if (m_segmentWatcher)
+	{
+		m_needsCompaction = true;
 
 		return;
 	}
 
-	for (int i = (rowCount() - 1); i >= 0; --i)
+	m_journalFile.close();
+
+	const QString oldJournalPath(m_journalPath + QLatin1String(".old"));
+
+	if (QFile::exists(m_journalPath))
 	{
-		if (index(i, 0).data(TimeVisitedRole).toDateTime().secsTo(QDateTime::currentDateTime()) < (period * 3600))
+		if (QFile::exists(oldJournalPath))
 		{
-			removeEntry(index(i, 0).data(IdentifierRole).toULongLong());
+			QFile journalFile(m_journalPath);
+			QFile oldJournalFile(oldJournalPath);
+
+			if (journalFile.open(QIODevice::ReadOnly) && oldJournalFile.open(QIODevice::WriteOnly | QIODevice::Append))
+			{
+				oldJournalFile.write(journalFile.readAll());
+				oldJournalFile.close();
+				journalFile.remove();
+			}
+		}
+		else
+		{
+			QFile::rename(m_journalPath, oldJournalPath);
 		}
 	}
+
+	HistorySnapshot snapshot;
+	snapshot.times = m_times;
+	snapshot.identifiers = m_identifiers;
+	snapshot.urls = m_urls;
+	snapshot.titles = m_titles;
+	snapshot.urlsPool = m_urlsPool.getValues();
+	snapshot.titlesPool = m_titlesPool.getValues();
+	snapshot.nextIdentifier = m_nextIdentifier;
+
+	m_compactionWatcher = new QFutureWatcher<QString>(this);
+	m_compactionWatcher->setFuture(QtConcurrent::run(&HistoryModel::saveSnapshot, snapshot, m_path, oldJournalPath));
+	m_journalRecords = 0;
+	m_needsCompaction = false;
+
+	connect(m_compactionWatcher, SIGNAL(finished()), this, SLOT(handleSnapshotSaved()));
+}
+
+void HistoryModel::clearExcessEntries(int limit)
+{
+	if (limit > 0 && m_times.count() > limit)
+	{
+		removeRange(0, (m_times.count() - limit));
+	}
+}
+
+void HistoryModel::clearRecentEntries(uint period)
+{
+	if (period == 0)
+	{
+		QByteArray record;
+		QDataStream stream(&record, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_4);
+		stream << static_cast<quint8>(ClearRecord);
+
+		beginResetModel();
+
+		clearEntries();
+
+		endResetModel();
+
+		writeRecord(record);
+		compact();
+
+		emit cleared();
+
+		return;
+	}
+
+	removeEntries(QDateTime::currentDateTime().addSecs(-(static_cast<qint64>(period) * 3600)).addMSecs(1), QDateTime());
 }
 
 void HistoryModel::clearOldestEntries(int period)
@@ -117,142 +311,638 @@ void HistoryModel::clearOldestEntries(int period)
 		return;
 	}
 
-	const QDateTime currentDateTime(QDateTime::currentDateTime());
+	removeEntries(QDateTime(), QDateTime(QDate::currentDate().addDays(-period), QTime(0, 0)));
+}
 
-	for (int i = (rowCount() - 1); i >= 0; --i)
+void HistoryModel::removeEntry(quint64 identifier)
+{
+	if (!m_positions.contains(identifier))
 	{
-		if (index(i, 0).data(TimeVisitedRole).toDateTime().daysTo(currentDateTime) > period)
+		return;
+	}
+
+	const int position(m_positions.value(identifier));
+	const int row(m_times.count() - position - 1);
+	QByteArray record;
+	QDataStream stream(&record, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_4);
+	stream << static_cast<quint8>(RemoveRecord) << QVector<quint64>({identifier});
+
+	writeRecord(record);
+
+	emit entryRemoved(identifier);
+
+	beginRemoveRows(QModelIndex(), row, row);
+
+	eraseEntries(position, 1);
+
+	endRemoveRows();
+
+	emit modelModified();
+}
+
+void HistoryModel::removeEntries(const QVector<quint64> &identifiers)
+{
+	QVector<quint64> removedIdentifiers;
+	removedIdentifiers.reserve(identifiers.count());
+
+	QSet<quint64> processedIdentifiers;
+	int firstPosition(m_times.count());
+	int lastPosition(-1);
+
+	for (int i = 0; i < identifiers.count(); ++i)
+	{
+		if (m_positions.contains(identifiers.at(i)) && !processedIdentifiers.contains(identifiers.at(i)))
 		{
-			removeEntry(index(i, 0).data(IdentifierRole).toULongLong());
+			const int position(m_positions.value(identifiers.at(i)));
+
+			firstPosition = qMin(firstPosition, position);
+			lastPosition = qMax(lastPosition, position);
+
+			processedIdentifiers.insert(identifiers.at(i));
+			removedIdentifiers.append(identifiers.at(i));
 		}
 	}
+
+	if (removedIdentifiers.isEmpty())
+	{
+		return;
+	}
+
+	if ((lastPosition - firstPosition + 1) == removedIdentifiers.count())
+	{
+		removeRange(firstPosition, removedIdentifiers.count());
+
+		return;
+	}
+
+	QByteArray record;
+	QDataStream stream(&record, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_4);
+	stream << static_cast<quint8>(RemoveRecord) << removedIdentifiers;
+
+	beginResetModel();
+
+	removeIdentifiers(removedIdentifiers);
+
+	endResetModel();
+
+	writeRecord(record);
+
+	emit entriesRemoved(removedIdentifiers);
+	emit modelModified();
 }
 
-void HistoryModel::removeEntry(quint64 identifier)
+void HistoryModel::removeEntries(const QDateTime &startTime, const QDateTime &endTime)
 {
-	HistoryEntryItem *entry(getEntry(identifier));
+	QVector<qint64>::const_iterator start(m_times.constBegin());
+	QVector<qint64>::const_iterator end(m_times.constEnd());
+
+	if (startTime.isValid())
+	{
+		start = std::lower_bound(m_times.constBegin(), m_times.constEnd(), startTime.toMSecsSinceEpoch());
+	}
+
+	if (endTime.isValid())
+	{
+		end = std::lower_bound(start, m_times.constEnd(), endTime.toMSecsSinceEpoch());
+	}
 
-	if (!entry)
+	removeRange((start - m_times.constBegin()), (end - start));
+}
+
+void HistoryModel::updateEntry(quint64 identifier, const QUrl &url, const QString &title, const QIcon &icon)
+{
+	if (!m_positions.contains(identifier))
 	{
 		return;
 	}
 
-	const QUrl url(Utils::normalizeUrl(entry->data(UrlRole).toUrl()));
+	const int position(m_positions.value(identifier));
+	const int row(m_times.count() - position - 1);
+
+	setEntryUrl(position, url);
+
+	m_titlesPool.removeValue(m_titles.at(position));
+	m_titles[position] = m_titlesPool.addValue(title);
+
+	if (icon.isNull())
+	{
+		m_icons.remove(identifier);
+	}
+	else
+	{
+		m_icons[identifier] = icon;
+	}
+
+	QByteArray record;
+	QDataStream stream(&record, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_4);
+	stream << static_cast<quint8>(UpdateRecord) << identifier << url << title;
+
+	writeRecord(record);
+
+	emit dataChanged(index(row, 0), index(row, 0));
+	emit entryModified(identifier);
+	emit modelModified();
+}
+
+void HistoryModel::insertEntry(int position, const QUrl &url, const QString &title, qint64 time, quint64 identifier)
+{
+	m_nextIdentifier = qMax(m_nextIdentifier, (identifier + 1));
+
+	m_times.insert(position, time);
+	m_identifiers.insert(position, identifier);
+	m_urls.insert(position, m_urlsPool.addValue(url));
+	m_titles.insert(position, m_titlesPool.addValue(title));
+
+	if (position == (m_times.count() - 1))
+	{
+		m_positions[identifier] = position;
+	}
+	else
+	{
+		updatePositions(position);
+	}
+
+	addUrl(Utils::normalizeUrl(url), identifier);
+}
 
-	if (m_urls.contains(url))
+void HistoryModel::eraseEntries(int position, int amount)
+{
+	for (int i = position; i < (position + amount); ++i)
 	{
-		m_urls[url].removeAll(entry);
+		const quint64 identifier(m_identifiers.at(i));
 
-		if (m_urls[url].isEmpty())
+		removeUrl(Utils::normalizeUrl(m_urlsPool.getValue(m_urls.at(i))), identifier);
+
+		m_urlsPool.removeValue(m_urls.at(i));
+		m_titlesPool.removeValue(m_titles.at(i));
+		m_positions.remove(identifier);
+		m_icons.remove(identifier);
+	}
+
+	m_times.remove(position, amount);
+	m_identifiers.remove(position, amount);
+	m_urls.remove(position, amount);
+	m_titles.remove(position, amount);
+
+	updatePositions(position);
+}
+
+void HistoryModel::removeIdentifiers(const QVector<quint64> &identifiers)
+{
+	QVector<int> positions;
+	positions.reserve(identifiers.count());
+
+	for (int i = 0; i < identifiers.count(); ++i)
+	{
+		if (m_positions.contains(identifiers.at(i)))
 		{
-			m_urls.remove(url);
+			positions.append(m_positions.value(identifiers.at(i)));
 		}
 	}
 
-	if (identifier > 0 && m_identifiers.contains(identifier))
+	if (positions.isEmpty())
 	{
-		m_identifiers.remove(identifier);
+		return;
 	}
 
-	emit entryRemoved(entry);
+	std::sort(positions.begin(), positions.end());
 
-	removeRow(entry->row());
+	positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
 
-	emit modelModified();
+	const int firstPosition(positions.first());
+	int amount(firstPosition);
+	int next(0);
+
+	for (int i = firstPosition; i < m_times.count(); ++i)
+	{
+		if (next < positions.count() && positions.at(next) == i)
+		{
+			const quint64 identifier(m_identifiers.at(i));
+
+			removeUrl(Utils::normalizeUrl(m_urlsPool.getValue(m_urls.at(i))), identifier);
+
+			m_urlsPool.removeValue(m_urls.at(i));
+			m_titlesPool.removeValue(m_titles.at(i));
+			m_positions.remove(identifier);
+			m_icons.remove(identifier);
+
+			++next;
+
+			continue;
+		}
+
+		m_times[amount] = m_times.at(i);
+		m_identifiers[amount] = m_identifiers.at(i);
+		m_urls[amount] = m_urls.at(i);
+		m_titles[amount] = m_titles.at(i);
+
+		++amount;
+	}
+
+	m_times.resize(amount);
+	m_identifiers.resize(amount);
+	m_urls.resize(amount);
+	m_titles.resize(amount);
+
+	updatePositions(firstPosition);
 }
 
-HistoryEntryItem* HistoryModel::addEntry(const QUrl &url, const QString &title, const QIcon &icon, const QDateTime &date, quint64 identifier)
+void HistoryModel::clearEntries()
 {
-	blockSignals(true);
+	m_times.clear();
+	m_identifiers.clear();
+	m_urls.clear();
+	m_titles.clear();
+	m_urlsPool.clear();
+	m_titlesPool.clear();
+	m_positions.clear();
+	m_icons.clear();
+	m_urlEntries.clear();
+	m_urlsIndex.clear();
+}
 
-	if (m_type == TypedHistory)
+void HistoryModel::mergeSegment(const HistorySegment &segment)
+{
+	const int amount(m_times.count() + segment.times.count());
+	QVector<qint64> times;
+	QVector<quint64> identifiers;
+	QVector<int> urls;
+	QVector<int> titles;
+	int i(segment.times.count() - 1);
+	int j(0);
+
+	times.reserve(amount);
+	identifiers.reserve(amount);
+	urls.reserve(amount);
+	titles.reserve(amount);
+
+	while (i >= 0 || j < m_times.count())
 	{
-		const QUrl normalizedUrl(Utils::normalizeUrl(url));
-
-		if (hasEntry(normalizedUrl))
+		if (j >= m_times.count() || (i >= 0 && segment.times.at(i) <= m_times.at(j)))
 		{
-			for (int i = 0; i < m_urls[normalizedUrl].count(); ++i)
+			const quint64 identifier(segment.identifiers.at(i));
+
+			if (!m_positions.contains(identifier))
 			{
-				removeEntry(m_urls[normalizedUrl][i]->data(IdentifierRole).toULongLong());
+				times.append(segment.times.at(i));
+				identifiers.append(identifier);
+				urls.append(m_urlsPool.addValue(segment.urls.at(i)));
+				titles.append(m_titlesPool.addValue(segment.titles.at(i)));
+
+				m_nextIdentifier = qMax(m_nextIdentifier, (identifier + 1));
+
+				addUrl(segment.normalizedUrls.at(i), identifier);
 			}
+
+			--i;
+		}
+		else
+		{
+			times.append(m_times.at(j));
+			identifiers.append(m_identifiers.at(j));
+			urls.append(m_urls.at(j));
+			titles.append(m_titles.at(j));
+
+			++j;
 		}
 	}
 
-	HistoryEntryItem *entry(new HistoryEntryItem());
-	entry->setIcon(icon);
+	m_times = times;
+	m_identifiers = identifiers;
+	m_urls = urls;
+	m_titles = titles;
+
+	updatePositions(0);
+}
+
+void HistoryModel::handleSegmentLoaded()
+{
+	const HistorySegment segment(m_segmentWatcher->result());
 
-	insertRow(0, entry);
-	setData(entry->index(), url, UrlRole);
-	setData(entry->index(), title, TitleRole);
-	setData(entry->index(), date, TimeVisitedRole);
+	m_segmentWatcher->deleteLater();
+	m_segmentWatcher = nullptr;
 
-	if (identifier == 0 || m_identifiers.contains(identifier))
+	if (segment.isTruncated)
 	{
-		identifier = (m_identifiers.isEmpty() ? 1 : (m_identifiers.keys().last() + 1));
+		Console::addMessage(tr("Failed to load history: %1").arg(tr("file is truncated")), Console::OtherCategory, Console::ErrorLevel, m_path);
 	}
 
-	setData(entry->index(), identifier, IdentifierRole);
+	beginResetModel();
+
+	mergeSegment(segment);
 
-	m_identifiers[identifier] = entry;
+	m_journalRecords = 0;
 
-	blockSignals(false);
+	replayJournal(m_journalPath + QLatin1String(".old"));
+	replayJournal(m_journalPath);
 
-	emit entryAdded(entry);
+	endResetModel();
+
+	if (m_needsCompaction || m_journalRecords > qMax(1000, (m_times.count() / 4)))
+	{
+		compact();
+	}
+
+	emit loaded();
+}
+
+void HistoryModel::handleSnapshotSaved()
+{
+	const QString errorString(m_compactionWatcher->result());
+
+	m_compactionWatcher->deleteLater();
+	m_compactionWatcher = nullptr;
+
+	if (!errorString.isEmpty())
+	{
+		Console::addMessage(QCoreApplication::translate("main", "Failed to save history: %1").arg(errorString), Console::OtherCategory, Console::ErrorLevel, m_path);
+	}
+}
+
+void HistoryModel::removeRange(int position, int amount)
+{
+	if (amount <= 0)
+	{
+		return;
+	}
+
+	const QVector<quint64> identifiers(m_identifiers.mid(position, amount));
+	const int row(m_times.count() - position - amount);
+	QByteArray record;
+	QDataStream stream(&record, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_4);
+	stream << static_cast<quint8>(RemoveRecord) << identifiers;
+
+	beginRemoveRows(QModelIndex(), row, (row + amount - 1));
+
+	eraseEntries(position, amount);
+
+	endRemoveRows();
+
+	writeRecord(record);
+
+	emit entriesRemoved(identifiers);
+	emit modelModified();
+}
+
+void HistoryModel::updatePositions(int position)
+{
+	for (int i = position; i < m_identifiers.count(); ++i)
+	{
+		m_positions[m_identifiers.at(i)] = i;
+	}
+}
+
+void HistoryModel::setEntryUrl(int position, const QUrl &url)
+{
+	const QUrl oldUrl(m_urlsPool.getValue(m_urls.at(position)));
+
+	if (url == oldUrl)
+	{
+		return;
+	}
+
+	const quint64 identifier(m_identifiers.at(position));
+
+	removeUrl(Utils::normalizeUrl(oldUrl), identifier);
+
+	m_urlsPool.removeValue(m_urls.at(position));
+	m_urls[position] = m_urlsPool.addValue(url);
+
+	addUrl(Utils::normalizeUrl(url), identifier);
+}
+
+void HistoryModel::addUrl(const QUrl &url, quint64 identifier)
+{
+	if (url.isEmpty())
+	{
+		return;
+	}
+
+	if (!m_urlEntries.contains(url))
+	{
+		const QStringList keys(Utils::createUrlMatchKeys(url));
+
+		for (int i = 0; i < keys.count(); ++i)
+		{
+			m_urlsIndex.insert(keys.at(i), url);
+		}
+	}
+
+	m_urlEntries[url].append(identifier);
+}
+
+void HistoryModel::removeUrl(const QUrl &url, quint64 identifier)
+{
+	if (!m_urlEntries.contains(url))
+	{
+		return;
+	}
+
+	m_urlEntries[url].removeAll(identifier);
+
+	if (m_urlEntries[url].isEmpty())
+	{
+		const QStringList keys(Utils::createUrlMatchKeys(url));
+
+		for (int i = 0; i < keys.count(); ++i)
+		{
+			m_urlsIndex.remove(keys.at(i), url);
+		}
+
+		m_urlEntries.remove(url);
+	}
+}
+
+QString HistoryModel::saveSnapshot(const HistorySnapshot &snapshot, const QString &path, const QString &journalPath)
+{
+	QSaveFile file(path);
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return file.errorString();
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_4);
+	stream << static_cast<quint32>(SnapshotMagic) << static_cast<quint32>(SnapshotVersion) << snapshot.nextIdentifier << static_cast<qint32>(snapshot.times.count());
+
+	for (int i = (snapshot.times.count() - 1); i >= 0; --i)
+	{
+		stream << snapshot.identifiers.at(i) << snapshot.times.at(i) << snapshot.urlsPool.value(snapshot.urls.at(i)) << snapshot.titlesPool.value(snapshot.titles.at(i));
+	}
+
+	if (stream.status() != QDataStream::Ok || !file.commit())
+	{
+		return file.errorString();
+	}
+
+	QFile::remove(journalPath);
+
+	return QString();
+}
+
+HistoryModel::HistorySegment HistoryModel::loadSegment(const QString &path, qint64 offset, int amount)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly) || !file.seek(offset))
+	{
+		HistorySegment segment;
+		segment.isTruncated = true;
+
+		return segment;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_4);
+
+	return readSegment(stream, amount, std::numeric_limits<qint64>::min());
+}
+
+HistoryModel::HistorySegment HistoryModel::readSegment(QDataStream &stream, int amount, qint64 minimumTime)
+{
+	HistorySegment segment;
+
+	for (int i = 0; i < amount; ++i)
+	{
+		quint64 identifier(0);
+		qint64 time(0);
+		QUrl url;
+		QString title;
+
+		stream >> identifier >> time >> url >> title;
+
+		if (stream.status() != QDataStream::Ok)
+		{
+			segment.isTruncated = true;
+
+			break;
+		}
+
+		segment.times.append(time);
+		segment.identifiers.append(identifier);
+		segment.urls.append(url);
+		segment.normalizedUrls.append(Utils::normalizeUrl(url));
+		segment.titles.append(title);
+
+		if (time < minimumTime)
+		{
+			break;
+		}
+	}
+
+	return segment;
+}
+
+HistoryModel::HistoryEntry HistoryModel::createEntry(int position) const
+{
+	HistoryEntry entry;
+
+	if (position < 0 || position >= m_times.count())
+	{
+		return entry;
+	}
+
+	entry.identifier = m_identifiers.at(position);
+	entry.url = m_urlsPool.getValue(m_urls.at(position));
+	entry.title = m_titlesPool.getValue(m_titles.at(position));
+	entry.icon = m_icons.value(entry.identifier);
+	entry.timeVisited = QDateTime::fromMSecsSinceEpoch(m_times.at(position));
 
 	return entry;
 }
 
-HistoryEntryItem* HistoryModel::getEntry(quint64 identifier) const
+HistoryModel::HistoryEntry HistoryModel::getEntry(quint64 identifier) const
+{
+	return createEntry(m_positions.value(identifier, -1));
+}
+
+QVariant HistoryModel::data(const QModelIndex &index, int role) const
 {
-	if (m_identifiers.contains(identifier))
+	const int position(getPosition(index));
+
+	if (position < 0)
+	{
+		return QVariant();
+	}
+
+	switch (role)
 	{
-		return m_identifiers[identifier];
+		case TitleRole:
+			return m_titlesPool.getValue(m_titles.at(position));
+		case UrlRole:
+			return m_urlsPool.getValue(m_urls.at(position));
+		case IdentifierRole:
+			return m_identifiers.at(position);
+		case TimeVisitedRole:
+			return QDateTime::fromMSecsSinceEpoch(m_times.at(position));
+		case Qt::DecorationRole:
+			return m_icons.value(m_identifiers.at(position));
+		default:
+			break;
 	}
 
-	return nullptr;
+	return QVariant();
 }
 
-QVector<HistoryModel::HistoryEntryMatch> HistoryModel::findEntries(const QString &prefix, bool markAsTypedIn) const
+QVector<HistoryModel::HistoryEntryMatch> HistoryModel::findEntries(const QString &prefix, bool markAsTypedIn, int limit) const
 {
-	QVector<HistoryEntryItem*> matchedEntries;
-	QVector<HistoryModel::HistoryEntryMatch> allMatches;
-	QVector<HistoryModel::HistoryEntryMatch> currentMatches;
-	QMultiMap<QDateTime, HistoryModel::HistoryEntryMatch> matchesMap;
-	QHash<QUrl, QVector<HistoryEntryItem*> >::const_iterator urlsIterator;
+	const QString key(prefix.toLower());
+	QSet<quint64> matchedEntries;
+	QVector<QPair<qint64, HistoryEntryMatch> > matches;
+	QMultiMap<QString, QUrl>::const_iterator iterator;
 
-	for (urlsIterator = m_urls.constBegin(); urlsIterator != m_urls.constEnd(); ++urlsIterator)
+	for (iterator = m_urlsIndex.lowerBound(key); (iterator != m_urlsIndex.constEnd() && iterator.key().startsWith(key)); ++iterator)
 	{
-		if (urlsIterator.value().isEmpty() || matchedEntries.contains(urlsIterator.value().first()))
+		const QVector<quint64> identifiers(m_urlEntries.value(iterator.value()));
+
+		if (identifiers.isEmpty() || matchedEntries.contains(identifiers.first()))
 		{
 			continue;
 		}
 
-		const QString result(Utils::matchUrl(urlsIterator.key(), prefix));
+		const QString result(Utils::matchUrl(iterator.value(), prefix));
 
 		if (!result.isEmpty())
 		{
-			HistoryEntryMatch match;
-			match.entry = urlsIterator.value().first();
-			match.match = result;
+			int position(-1);
 
-			if (markAsTypedIn)
+			for (int i = 0; i < identifiers.count(); ++i)
 			{
-				match.isTypedIn = true;
+				position = qMax(position, m_positions.value(identifiers.at(i)));
 			}
 
-			matchesMap.insert(match.entry->data(TimeVisitedRole).toDateTime(), match);
+			HistoryEntryMatch match;
+			match.entry = createEntry(position);
+			match.match = result;
+			match.isTypedIn = markAsTypedIn;
+
+			matches.append(qMakePair(m_times.at(position), match));
 
-			matchedEntries.append(match.entry);
+			matchedEntries.insert(identifiers.first());
 		}
 	}
 
-	currentMatches = matchesMap.values().toVector();
+	std::stable_sort(matches.begin(), matches.end(), [&](const QPair<qint64, HistoryEntryMatch> &first, const QPair<qint64, HistoryEntryMatch> &second)
+	{
+		return (first.first > second.first);
+	});
+
+	if (limit >= 0 && matches.count() > limit)
+	{
+		matches.resize(limit);
+	}
 
-	matchesMap.clear();
+	QVector<HistoryModel::HistoryEntryMatch> allMatches;
+	allMatches.reserve(matches.count());
 
-	for (int i = (currentMatches.count() - 1); i >= 0; --i)
+	for (int i = 0; i < matches.count(); ++i)
 	{
-		allMatches.append(currentMatches.at(i));
+		allMatches.append(matches.at(i).second);
 	}
 
 	return allMatches;
@@ -263,91 +953,180 @@ HistoryModel::HistoryType HistoryModel::getType() const
 	return m_type;
 }
 
-bool HistoryModel::save(const QString &path) const
+quint64 HistoryModel::addEntry(const QUrl &url, const QString &title, const QIcon &icon, const QDateTime &date, quint64 identifier)
+{
+	if (m_type == TypedHistory)
+	{
+		const QVector<quint64> identifiers(m_urlEntries.value(Utils::normalizeUrl(url)));
+
+		for (int i = 0; i < identifiers.count(); ++i)
+		{
+			removeEntry(identifiers.at(i));
+		}
+	}
+
+	if (identifier == 0 || m_positions.contains(identifier))
+	{
+		identifier = m_nextIdentifier;
+	}
+
+	const qint64 time(date.toMSecsSinceEpoch());
+	const int position(std::upper_bound(m_times.constBegin(), m_times.constEnd(), time) - m_times.constBegin());
+	const int row(m_times.count() - position);
+	QByteArray record;
+	QDataStream stream(&record, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_4);
+	stream << static_cast<quint8>(AddRecord) << identifier << time << url << title;
+
+	beginInsertRows(QModelIndex(), row, row);
+
+	insertEntry(position, url, title, time, identifier);
+
+	if (!icon.isNull())
+	{
+		m_icons[identifier] = icon;
+	}
+
+	endInsertRows();
+
+	writeRecord(record);
+
+	emit entryAdded(identifier);
+
+	return identifier;
+}
+
+int HistoryModel::getPosition(const QModelIndex &index) const
+{
+	if (!index.isValid() || index.parent().isValid() || index.row() < 0 || index.row() >= m_times.count())
+	{
+		return -1;
+	}
+
+	return (m_times.count() - index.row() - 1);
+}
+
+bool HistoryModel::loadSnapshot(const QString &path)
 {
-	if (SessionsManager::isReadOnly())
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly))
 	{
 		return false;
 	}
 
-	QJsonArray historyArray;
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_4);
 
-	for (int i = 0; i < rowCount(); ++i)
+	quint32 magic(0);
+	quint32 version(0);
+	quint64 nextIdentifier(1);
+	qint32 amount(0);
+
+	stream >> magic >> version;
+
+	if (version >= 2)
 	{
-		QStandardItem *entry(item(i));
+		stream >> nextIdentifier;
+	}
 
-		if (entry)
-		{
-			QJsonObject entryObject;
-			entryObject.insert(QLatin1String("url"), entry->data(UrlRole).toUrl().toString());
-			entryObject.insert(QLatin1String("title"), entry->data(TitleRole).toString());
-			entryObject.insert(QLatin1String("time"), entry->data(TimeVisitedRole).toDateTime().toString(QLatin1String("yyyy-MM-dd hh:mm:ss")));
+	stream >> amount;
 
-			historyArray.prepend(entryObject);
-		}
+	if (stream.status() != QDataStream::Ok || magic != SnapshotMagic || version < 1 || version > SnapshotVersion || amount < 0)
+	{
+		Console::addMessage(tr("Failed to load history: %1").arg(tr("invalid file format")), Console::OtherCategory, Console::ErrorLevel, path);
+
+		return false;
 	}
 
-	JsonSettings settings;
-	settings.setArray(historyArray);
+	m_nextIdentifier = qMax(m_nextIdentifier, nextIdentifier);
+
+	const HistorySegment segment(readSegment(stream, amount, ((version < 2) ? std::numeric_limits<qint64>::min() : QDateTime::currentDateTime().addDays(-7).toMSecsSinceEpoch())));
+
+	mergeSegment(segment);
+
+	if (segment.isTruncated)
+	{
+		Console::addMessage(tr("Failed to load history: %1").arg(tr("file is truncated")), Console::OtherCategory, Console::ErrorLevel, path);
+	}
+	else if (segment.times.count() < amount)
+	{
+		m_segmentWatcher = new QFutureWatcher<HistorySegment>(this);
+		m_segmentWatcher->setFuture(QtConcurrent::run(&HistoryModel::loadSegment, path, file.pos(), (amount - segment.times.count())));
+
+		connect(m_segmentWatcher, SIGNAL(finished()), this, SLOT(handleSegmentLoaded()));
+	}
+
+	return true;
+}
 
-	return settings.save(path);
+int HistoryModel::rowCount(const QModelIndex &index) const
+{
+	return (index.isValid() ? 0 : m_times.count());
 }
 
 bool HistoryModel::setData(const QModelIndex &index, const QVariant &value, int role)
 {
-	HistoryEntryItem *entry(static_cast<HistoryEntryItem*>(itemFromIndex(index)));
+	const int position(getPosition(index));
 
-	if (!entry)
+	if (position < 0)
 	{
-		return QStandardItemModel::setData(index, value, role);
+		return false;
 	}
 
-	if (role == UrlRole && value.toUrl() != index.data(UrlRole).toUrl())
+	const quint64 identifier(m_identifiers.at(position));
+
+	switch (role)
 	{
-		const QUrl oldUrl(Utils::normalizeUrl(index.data(UrlRole).toUrl()));
-		const QUrl newUrl(Utils::normalizeUrl(value.toUrl()));
+		case TitleRole:
+			m_titlesPool.removeValue(m_titles.at(position));
+			m_titles[position] = m_titlesPool.addValue(value.toString());
 
-		if (!oldUrl.isEmpty() && m_urls.contains(oldUrl))
-		{
-			m_urls[oldUrl].removeAll(entry);
+			break;
+		case UrlRole:
+			setEntryUrl(position, value.toUrl());
 
-			if (m_urls[oldUrl].isEmpty())
+			break;
+		case Qt::DecorationRole:
+			if (value.value<QIcon>().isNull())
 			{
-				m_urls.remove(oldUrl);
+				m_icons.remove(identifier);
 			}
-		}
-
-		if (!newUrl.isEmpty())
-		{
-			if (!m_urls.contains(newUrl))
+			else
 			{
-				m_urls[newUrl] = QVector<HistoryEntryItem*>();
+				m_icons[identifier] = value.value<QIcon>();
 			}
 
-			m_urls[newUrl].append(entry);
-		}
+			break;
+		default:
+			return false;
 	}
 
-	entry->setItemData(value, role);
-
-	switch (role)
+	if (role != Qt::DecorationRole)
 	{
-		case TitleRole:
-		case UrlRole:
-		case IdentifierRole:
-		case TimeVisitedRole:
-			emit entryModified(entry);
-			emit modelModified();
+		QByteArray record;
+		QDataStream stream(&record, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_4);
+		stream << static_cast<quint8>(UpdateRecord) << identifier << m_urlsPool.getValue(m_urls.at(position)) << m_titlesPool.getValue(m_titles.at(position));
 
-			break;
+		writeRecord(record);
 	}
 
+	emit dataChanged(index, index, QVector<int>({role}));
+	emit entryModified(identifier);
+	emit modelModified();
+
 	return true;
 }
 
+bool HistoryModel::isLoading() const
+{
+	return (m_segmentWatcher != nullptr);
+}
+
 bool HistoryModel::hasEntry(const QUrl &url) const
 {
-	return m_urls.contains(url);
+	return m_urlEntries.contains(url);
 }
 
 }
@@ -21,26 +21,95 @@
 #ifndef OTTER_HISTORYMODEL_H
 #define OTTER_HISTORYMODEL_H
 
+#include <QtCore/QAbstractListModel>
 #include <QtCore/QDateTime>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QFutureWatcher>
 #include <QtCore/QUrl>
-#include <QtGui/QStandardItemModel>
+#include <QtGui/QIcon>
 
 namespace Otter
 {
 
-class HistoryEntryItem : public QStandardItem
+template<typename T>
+class HistoryValuesPool final
 {
 public:
-	void setData(const QVariant &value, int role) override;
-	void setItemData(const QVariant &value, int role);
+	void clear()
+	{
+		m_values.clear();
+		m_references.clear();
+		m_freeIndexes.clear();
+		m_indexes.clear();
+	}
 
-protected:
-	explicit HistoryEntryItem();
+	void removeValue(int index)
+	{
+		if (index < 0 || index >= m_references.count() || m_references.at(index) == 0)
+		{
+			return;
+		}
+
+		--m_references[index];
+
+		if (m_references.at(index) == 0)
+		{
+			m_indexes.remove(m_values.at(index));
+			m_values[index] = T();
+			m_freeIndexes.append(index);
+		}
+	}
+
+	T getValue(int index) const
+	{
+		return m_values.value(index);
+	}
+
+	QVector<T> getValues() const
+	{
+		return m_values;
+	}
+
+	int addValue(const T &value)
+	{
+		int index(m_indexes.value(value, -1));
+
+		if (index >= 0)
+		{
+			++m_references[index];
+
+			return index;
+		}
+
+		if (m_freeIndexes.isEmpty())
+		{
+			index = m_values.count();
+
+			m_values.append(value);
+			m_references.append(1);
+		}
+		else
+		{
+			index = m_freeIndexes.takeLast();
 
-friend class HistoryModel;
+			m_values[index] = value;
+			m_references[index] = 1;
+		}
+
+		m_indexes[value] = index;
+
+		return index;
+	}
+
+private:
+	QVector<T> m_values;
+	QVector<int> m_references;
+	QVector<int> m_freeIndexes;
+	QHash<T, int> m_indexes;
 };
 
-class HistoryModel final : public QStandardItemModel
+class HistoryModel final : public QAbstractListModel
 {
 	Q_OBJECT
 
@@ -59,9 +128,23 @@ public:
 		TypedHistory
 	};
 
+	struct HistoryEntry
+	{
+		QUrl url;
+		QString title;
+		QIcon icon;
+		QDateTime timeVisited;
+		quint64 identifier = 0;
+
+		bool isValid() const
+		{
+			return (identifier > 0);
+		}
+	};
+
 	struct HistoryEntryMatch
 	{
-		HistoryEntryItem *entry = nullptr;
+		HistoryEntry entry;
 		QString match;
 		bool isTypedIn = false;
 	};
@@ -72,25 +155,113 @@ public:
 	void clearRecentEntries(uint period);
 	void clearOldestEntries(int period);
 	void removeEntry(quint64 identifier);
-	HistoryEntryItem* addEntry(const QUrl &url, const QString &title, const QIcon &icon, const QDateTime &date = QDateTime::currentDateTime(), quint64 identifier = 0);
-	HistoryEntryItem* getEntry(quint64 identifier) const;
-	QVector<HistoryEntryMatch> findEntries(const QString &prefix, bool markAsTypedIn = false) const;
+	void removeEntries(const QVector<quint64> &identifiers);
+	void removeEntries(const QDateTime &startTime, const QDateTime &endTime);
+	void updateEntry(quint64 identifier, const QUrl &url, const QString &title, const QIcon &icon);
+	HistoryEntry getEntry(quint64 identifier) const;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	QVector<HistoryEntryMatch> findEntries(const QString &prefix, bool markAsTypedIn = false, int limit = -1) const;
 	HistoryType getType() const;
+	quint64 addEntry(const QUrl &url, const QString &title, const QIcon &icon, const QDateTime &date = QDateTime::currentDateTime(), quint64 identifier = 0);
+	int rowCount(const QModelIndex &index = {}) const override;
+	bool isLoading() const;
 	bool hasEntry(const QUrl &url) const;
-	bool save(const QString &path) const;
 	bool setData(const QModelIndex &index, const QVariant &value, int role) override;
 
+public slots:
+	void compact();
+
+protected:
+	enum StorageFormat : quint32
+	{
+		SnapshotMagic = 0x4F484953,
+		SnapshotVersion = 2
+	};
+
+	enum JournalRecordType
+	{
+		UnknownRecord = 0,
+		AddRecord,
+		UpdateRecord,
+		RemoveRecord,
+		ClearRecord
+	};
+
+	struct HistorySnapshot
+	{
+		QVector<qint64> times;
+		QVector<quint64> identifiers;
+		QVector<int> urls;
+		QVector<int> titles;
+		QVector<QUrl> urlsPool;
+		QVector<QString> titlesPool;
+		quint64 nextIdentifier = 1;
+	};
+
+	struct HistorySegment
+	{
+		QVector<qint64> times;
+		QVector<quint64> identifiers;
+		QVector<QUrl> urls;
+		QVector<QUrl> normalizedUrls;
+		QVector<QString> titles;
+		bool isTruncated = false;
+	};
+
+	void loadLegacyHistory(const QString &path);
+	void replayJournal(const QString &path);
+	void writeRecord(const QByteArray &record);
+	void insertEntry(int position, const QUrl &url, const QString &title, qint64 time, quint64 identifier);
+	void eraseEntries(int position, int amount);
+	void removeIdentifiers(const QVector<quint64> &identifiers);
+	void clearEntries();
+	void mergeSegment(const HistorySegment &segment);
+	void removeRange(int position, int amount);
+	void updatePositions(int position);
+	void setEntryUrl(int position, const QUrl &url);
+	void addUrl(const QUrl &url, quint64 identifier);
+	void removeUrl(const QUrl &url, quint64 identifier);
+	HistoryEntry createEntry(int position) const;
+	int getPosition(const QModelIndex &index) const;
+	bool loadSnapshot(const QString &path);
+
+	static HistorySegment loadSegment(const QString &path, qint64 offset, int amount);
+	static HistorySegment readSegment(QDataStream &stream, int amount, qint64 minimumTime);
+	static QString saveSnapshot(const HistorySnapshot &snapshot, const QString &path, const QString &journalPath);
+
+protected slots:
+	void handleSegmentLoaded();
+	void handleSnapshotSaved();
+
 private:
-	QHash<QUrl, QVector<HistoryEntryItem*> > m_urls;
-	QMap<quint64, HistoryEntryItem*> m_identifiers;
+	QString m_path;
+	QString m_journalPath;
+	QFile m_journalFile;
+	QFutureWatcher<QString> *m_compactionWatcher;
+	QFutureWatcher<HistorySegment> *m_segmentWatcher;
+	QVector<qint64> m_times;
+	QVector<quint64> m_identifiers;
+	QVector<int> m_urls;
+	QVector<int> m_titles;
+	HistoryValuesPool<QUrl> m_urlsPool;
+	HistoryValuesPool<QString> m_titlesPool;
+	QHash<quint64, int> m_positions;
+	QHash<quint64, QIcon> m_icons;
+	QHash<QUrl, QVector<quint64> > m_urlEntries;
+	QMultiMap<QString, QUrl> m_urlsIndex;
+	quint64 m_nextIdentifier;
 	HistoryType m_type;
+	int m_journalRecords;
+	bool m_needsCompaction;
 
 signals:
 	void cleared();
-	void entryAdded(HistoryEntryItem *entry);
-	void entryModified(HistoryEntryItem *entry);
-	void entryRemoved(HistoryEntryItem *entry);
+	void entryAdded(quint64 identifier);
+	void entryModified(quint64 identifier);
+	void entryRemoved(quint64 identifier);
+	void entriesRemoved(const QVector<quint64> &identifiers);
 	void modelModified();
+	void loaded();
 };
 
 }
@@ -115,6 +115,8 @@ public:
 			overrides.endGroup();
 		}
 
+		SettingsManager::loadOptions();
+
 		const QStringList sessions(SessionsManager::getSessions());
 
 		for (int i = 0; i < sessions.count(); ++i)
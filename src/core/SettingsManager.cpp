@@ -28,6 +28,19 @@
 #include <QtCore/QTextStream>
 #include <QtCore/QVector>
 
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+#include <QtCore/QElapsedTimer>
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+#if defined(Q_OS_UNIX) && defined(Q_CC_GNU)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#endif
+#endif
+
 namespace Otter
 {
 
@@ -36,6 +49,14 @@ QString SettingsManager::m_globalPath;
 QString SettingsManager::m_overridePath;
 QVector<SettingsManager::OptionDefinition> SettingsManager::m_definitions;
 QHash<QString, int> SettingsManager::m_customOptions;
+QHash<QString, QHash<int, QVariant> > SettingsManager::m_overrides;
+QVector<QVariant> SettingsManager::m_globalOptions;
+QReadWriteLock SettingsManager::m_optionsLock;
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+QHash<int, SettingsManager::AccessStatistics> SettingsManager::m_optionsStatistics;
+QHash<quintptr, SettingsManager::AccessStatistics> SettingsManager::m_callersStatistics;
+QMutex SettingsManager::m_statisticsMutex;
+#endif
 int SettingsManager::m_identifierCounter(-1);
 int SettingsManager::m_optionIdentifierEnumerator(0);
 bool SettingsManager::m_hasWildcardedOverrides(false);
@@ -236,28 +257,90 @@ void SettingsManager::createInstance(const QString &path)
 	registerOption(Updates_LastCheckOption, StringType, QString());
 	registerOption(Updates_ServerUrlOption, StringType, QLatin1String("https://www.otter-browser.org/updates/update.json"));
 
-	const QStringList hosts(QSettings(m_overridePath, QSettings::IniFormat).childGroups());
+	loadOptions();
+}
+
+void SettingsManager::loadOptions()
+{
+	QVector<QVariant> globalOptions(m_definitions.count());
+	QSettings globalSettings(m_globalPath, QSettings::IniFormat);
+	const QStringList keys(globalSettings.allKeys());
+
+	for (int i = 0; i < keys.count(); ++i)
+	{
+		const int identifier(getOptionIdentifier(keys.at(i)));
+
+		if (identifier >= 0 && identifier < globalOptions.count())
+		{
+			globalOptions[identifier] = globalSettings.value(keys.at(i));
+		}
+	}
+
+	QHash<QString, QHash<int, QVariant> > overrides;
+	QSettings overridesSettings(m_overridePath, QSettings::IniFormat);
+	const QStringList hosts(overridesSettings.childGroups());
+	bool hasWildcardedOverrides(false);
 
 	for (int i = 0; i < hosts.count(); ++i)
 	{
-		if (hosts.at(i).startsWith(QLatin1Char('*')))
+		overridesSettings.beginGroup(hosts.at(i));
+
+		const QStringList hostKeys(overridesSettings.allKeys());
+
+		for (int j = 0; j < hostKeys.count(); ++j)
 		{
-			m_hasWildcardedOverrides = true;
+			const int identifier(getOptionIdentifier(hostKeys.at(j)));
 
-			break;
+			if (identifier >= 0 && identifier < globalOptions.count())
+			{
+				overrides[hosts.at(i)][identifier] = overridesSettings.value(hostKeys.at(j));
+			}
+		}
+
+		overridesSettings.endGroup();
+
+		if (hosts.at(i).startsWith(QLatin1Char('*')))
+		{
+			hasWildcardedOverrides = true;
 		}
 	}
+
+	QWriteLocker locker(&m_optionsLock);
+
+	m_globalOptions = globalOptions;
+	m_overrides = overrides;
+	m_hasWildcardedOverrides = hasWildcardedOverrides;
 }
 
 void SettingsManager::removeOverride(const QUrl &url, const QString &key)
 {
+	const QString host(getHost(url));
+
 	if (key.isEmpty())
 	{
-		QSettings(m_overridePath, QSettings::IniFormat).remove(getHost(url));
+		m_optionsLock.lockForWrite();
+		m_overrides.remove(host);
+		m_optionsLock.unlock();
+
+		QSettings(m_overridePath, QSettings::IniFormat).remove(host);
 	}
 	else
 	{
-		QSettings(m_overridePath, QSettings::IniFormat).remove(getHost(url) + QLatin1Char('/') + key);
+		m_optionsLock.lockForWrite();
+
+		if (m_overrides.contains(host))
+		{
+			m_overrides[host].remove(getOptionIdentifier(key));
+
+			if (m_overrides[host].isEmpty())
+			{
+				m_overrides.remove(host);
+			}
+		}
+
+		m_optionsLock.unlock();
+
+		QSettings(m_overridePath, QSettings::IniFormat).remove(host + QLatin1Char('/') + key);
 	}
 }
 
@@ -284,26 +367,53 @@ void SettingsManager::updateOptionDefinition(int identifier, const SettingsManag
 
 void SettingsManager::setOption(int identifier, const QVariant &value, const QUrl &url)
 {
+	if (identifier < 0 || identifier >= m_definitions.count())
+	{
+		return;
+	}
+
 	const QString name(getOptionName(identifier));
 
 	if (!url.isEmpty())
 	{
-		const QString overrideName(getHost(url) + QLatin1Char('/') + name);
+		const QString host(getHost(url));
+		const QString overrideName(host + QLatin1Char('/') + name);
+
+		m_optionsLock.lockForWrite();
 
 		if (value.isNull())
 		{
-			QSettings(m_overridePath, QSettings::IniFormat).remove(overrideName);
+			if (m_overrides.contains(host))
+			{
+				m_overrides[host].remove(identifier);
+
+				if (m_overrides[host].isEmpty())
+				{
+					m_overrides.remove(host);
+				}
+			}
 		}
 		else
 		{
-			QSettings(m_overridePath, QSettings::IniFormat).setValue(overrideName, value);
+			m_overrides[host][identifier] = value;
 		}
 
-		if (!m_hasWildcardedOverrides && overrideName.startsWith(QLatin1Char('*')))
+		if (!m_hasWildcardedOverrides && host.startsWith(QLatin1Char('*')))
 		{
 			m_hasWildcardedOverrides = true;
 		}
 
+		m_optionsLock.unlock();
+
+		if (value.isNull())
+		{
+			QSettings(m_overridePath, QSettings::IniFormat).remove(overrideName);
+		}
+		else
+		{
+			QSettings(m_overridePath, QSettings::IniFormat).setValue(overrideName, value);
+		}
+
 		emit m_instance->optionChanged(identifier, value, url);
 
 		return;
@@ -311,12 +421,38 @@ void SettingsManager::setOption(int identifier, const QVariant &value, const QUr
 
 	if (getOption(identifier) != value)
 	{
+		m_optionsLock.lockForWrite();
+		m_globalOptions[identifier] = value;
+		m_optionsLock.unlock();
+
 		QSettings(m_globalPath, QSettings::IniFormat).setValue(name, value);
 
 		emit m_instance->optionChanged(identifier, value);
 	}
 }
 
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+void SettingsManager::addAccessStatistics(AccessStatistics *statistics, bool hasUrl, qint64 time)
+{
+	++statistics->calls;
+
+	if (hasUrl)
+	{
+		++statistics->urlCalls;
+	}
+
+	statistics->time += time;
+}
+
+void SettingsManager::recordAccess(int identifier, quintptr caller, bool hasUrl, qint64 time)
+{
+	QMutexLocker locker(&m_statisticsMutex);
+
+	addAccessStatistics(&m_optionsStatistics[identifier], hasUrl, time);
+	addAccessStatistics(&m_callersStatistics[caller], hasUrl, time);
+}
+#endif
+
 SettingsManager* SettingsManager::getInstance()
 {
 	return m_instance;
@@ -432,6 +568,110 @@ QString SettingsManager::createReport()
 	return report;
 }
 
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+QString SettingsManager::createAccessReport()
+{
+	m_statisticsMutex.lock();
+
+	const QHash<int, AccessStatistics> optionsStatistics(m_optionsStatistics);
+	const QHash<quintptr, AccessStatistics> callersStatistics(m_callersStatistics);
+
+	m_statisticsMutex.unlock();
+
+	QVector<QPair<qint64, int> > options;
+	options.reserve(optionsStatistics.count());
+
+	quint64 calls(0);
+	qint64 time(0);
+	QHash<int, AccessStatistics>::const_iterator optionsIterator;
+
+	for (optionsIterator = optionsStatistics.constBegin(); optionsIterator != optionsStatistics.constEnd(); ++optionsIterator)
+	{
+		options.append(qMakePair(optionsIterator.value().time, optionsIterator.key()));
+
+		calls += optionsIterator.value().calls;
+		time += optionsIterator.value().time;
+	}
+
+	QVector<QPair<qint64, quintptr> > callers;
+	callers.reserve(callersStatistics.count());
+
+	QHash<quintptr, AccessStatistics>::const_iterator callersIterator;
+
+	for (callersIterator = callersStatistics.constBegin(); callersIterator != callersStatistics.constEnd(); ++callersIterator)
+	{
+		callers.append(qMakePair(callersIterator.value().time, callersIterator.key()));
+	}
+
+	std::sort(options.begin(), options.end(), std::greater<QPair<qint64, int> >());
+	std::sort(callers.begin(), callers.end(), std::greater<QPair<qint64, quintptr> >());
+
+	QString report;
+	QTextStream stream(&report);
+	stream.setFieldAlignment(QTextStream::AlignLeft);
+	stream << QStringLiteral("Settings access (%1 calls, %2 ms):\n").arg(calls).arg(time / 1000000.0);
+
+	for (int i = 0; i < options.count(); ++i)
+	{
+		const AccessStatistics statistics(optionsStatistics.value(options.at(i).second));
+
+		stream << QLatin1Char('\t');
+		stream.setFieldWidth(50);
+		stream << getOptionName(options.at(i).second);
+		stream.setFieldWidth(20);
+		stream << QStringLiteral("%1 calls").arg(statistics.calls);
+		stream << QStringLiteral("%1 with URL").arg(statistics.urlCalls);
+		stream << QStringLiteral("%1 ms").arg(statistics.time / 1000000.0);
+		stream.setFieldWidth(0);
+		stream << QLatin1Char('\n');
+	}
+
+	stream << QLatin1String("\nSettings access callers:\n");
+
+	for (int i = 0; i < callers.count(); ++i)
+	{
+		const AccessStatistics statistics(callersStatistics.value(callers.at(i).second));
+
+		stream << QLatin1Char('\t');
+		stream.setFieldWidth(20);
+		stream << QStringLiteral("%1 calls").arg(statistics.calls);
+		stream << QStringLiteral("%1 ms").arg(statistics.time / 1000000.0);
+		stream.setFieldWidth(0);
+		stream << getCallerName(callers.at(i).second);
+		stream << QLatin1Char('\n');
+	}
+
+	stream << QLatin1Char('\n');
+
+	return report;
+}
+
+QString SettingsManager::getCallerName(quintptr caller)
+{
+	if (caller == 0)
+	{
+		return QLatin1String("unknown");
+	}
+
+#if defined(Q_OS_UNIX) && defined(Q_CC_GNU)
+	Dl_info information;
+
+	if (dladdr(reinterpret_cast<void*>(caller), &information) != 0 && information.dli_sname)
+	{
+		int status(0);
+		char *demangledName(abi::__cxa_demangle(information.dli_sname, nullptr, nullptr, &status));
+		const QString name((status == 0 && demangledName) ? QString::fromLatin1(demangledName) : QString::fromLatin1(information.dli_sname));
+
+		free(demangledName);
+
+		return QStringLiteral("%1+0x%2").arg(name).arg((caller - reinterpret_cast<quintptr>(information.dli_saddr)), 0, 16);
+	}
+#endif
+
+	return QStringLiteral("0x%1").arg(caller, 0, 16);
+}
+#endif
+
 QString SettingsManager::getGlobalPath()
 {
 	return m_globalPath;
@@ -463,38 +703,65 @@ QString SettingsManager::getHost(const QUrl &url)
 
 QVariant SettingsManager::getOption(int identifier, const QUrl &url)
 {
-	if (identifier < 0 || identifier >= m_definitions.count())
-	{
-		return QVariant();
-	}
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+	QElapsedTimer timer;
+	timer.start();
+
+	const QVariant value(readOption(identifier, url));
+#ifdef Q_CC_GNU
+	const quintptr caller(reinterpret_cast<quintptr>(__builtin_return_address(0)));
+#else
+	const quintptr caller(0);
+#endif
+
+	recordAccess(identifier, caller, !url.isEmpty(), timer.nsecsElapsed());
+
+	return value;
+#else
+	return readOption(identifier, url);
+#endif
+}
 
-	const QString name(getOptionName(identifier));
+QVariant SettingsManager::readOption(int identifier, const QUrl &url)
+{
+	QReadLocker locker(&m_optionsLock);
 
-	if (url.isEmpty())
+	if (identifier < 0 || identifier >= m_globalOptions.count())
 	{
-		return QSettings(m_globalPath, QSettings::IniFormat).value(name, m_definitions.at(identifier).defaultValue);
+		return QVariant();
 	}
 
-	const QString host(getHost(url));
-	const QString overrideName(host + QLatin1Char('/') + name);
-	const QSettings overrides(m_overridePath, QSettings::IniFormat);
-
-	if (m_hasWildcardedOverrides && !overrides.contains(overrideName))
+	if (!url.isEmpty() && !m_overrides.isEmpty())
 	{
-		const QStringList hostParts(host.split(QLatin1Char('.')));
+		const QString host(getHost(url));
+		QHash<QString, QHash<int, QVariant> >::const_iterator iterator(m_overrides.constFind(host));
 
-		for (int i = 1; i < hostParts.count(); ++i)
+		if (iterator != m_overrides.constEnd() && iterator.value().contains(identifier))
 		{
-			const QString wildcardedName(QLatin1String("*.") + QStringList(hostParts.mid(i)).join(QLatin1Char('.')) + QLatin1Char('/') + name);
+			return iterator.value().value(identifier);
+		}
 
-			if (overrides.contains(wildcardedName))
+		if (m_hasWildcardedOverrides)
+		{
+			int dotPosition(host.indexOf(QLatin1Char('.')));
+
+			while (dotPosition >= 0)
 			{
-				return QSettings(m_overridePath, QSettings::IniFormat).value(wildcardedName, getOption(identifier));
+				iterator = m_overrides.constFind(QLatin1Char('*') + host.mid(dotPosition));
+
+				if (iterator != m_overrides.constEnd() && iterator.value().contains(identifier))
+				{
+					return iterator.value().value(identifier);
+				}
+
+				dotPosition = host.indexOf(QLatin1Char('.'), (dotPosition + 1));
 			}
 		}
 	}
 
-	return QSettings(m_overridePath, QSettings::IniFormat).value(overrideName, getOption(identifier));
+	const QVariant &value(m_globalOptions.at(identifier));
+
+	return (value.isValid() ? value : m_definitions.at(identifier).defaultValue);
 }
 
 QStringList SettingsManager::getOptions()
@@ -540,7 +807,22 @@ int SettingsManager::registerOption(const QString &name, OptionType type, const
 
 	m_customOptions[name] = identifier;
 
+	QSettings overridesSettings(m_overridePath, QSettings::IniFormat);
+	const QStringList hosts(overridesSettings.childGroups());
+	QWriteLocker locker(&m_optionsLock);
+
 	m_definitions.append(definition);
+	m_globalOptions.append(QSettings(m_globalPath, QSettings::IniFormat).value(name));
+
+	for (int i = 0; i < hosts.count(); ++i)
+	{
+		const QString overrideName(hosts.at(i) + QLatin1Char('/') + name);
+
+		if (overridesSettings.contains(overrideName))
+		{
+			m_overrides[hosts.at(i)][identifier] = overridesSettings.value(overrideName);
+		}
+	}
 
 	return identifier;
 }
@@ -565,12 +847,15 @@ int SettingsManager::getOptionIdentifier(const QString &name)
 
 bool SettingsManager::hasOverride(const QUrl &url, int identifier)
 {
+	QReadLocker locker(&m_optionsLock);
+	const QString host(getHost(url));
+
 	if (identifier < 0)
 	{
-		return QSettings(m_overridePath, QSettings::IniFormat).childGroups().contains(getHost(url));
+		return m_overrides.contains(host);
 	}
 
-	return QSettings(m_overridePath, QSettings::IniFormat).contains(getHost(url) + QLatin1Char('/') + getOptionName(identifier));
+	return m_overrides.value(host).contains(identifier);
 }
 
 }
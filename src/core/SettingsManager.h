@@ -22,7 +22,9 @@
 #ifndef OTTER_SETTINGSMANAGER_H
 #define OTTER_SETTINGSMANAGER_H
 
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
+#include <QtCore/QReadWriteLock>
 #include <QtCore/QUrl>
 #include <QtCore/QVariant>
 #include <QtGui/QIcon>
@@ -291,13 +293,26 @@ public:
 		}
 	};
 
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+	struct AccessStatistics
+	{
+		quint64 calls = 0;
+		quint64 urlCalls = 0;
+		qint64 time = 0;
+	};
+#endif
+
 	static void createInstance(const QString &path);
+	static void loadOptions();
 	static void removeOverride(const QUrl &url, const QString &key = {});
 	static void updateOptionDefinition(int identifier, const OptionDefinition &definition);
 	static void setOption(int identifier, const QVariant &value, const QUrl &url = {});
 	static SettingsManager* getInstance();
 	static QString createDisplayValue(int identifier, const QVariant &value);
 	static QString createReport();
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+	static QString createAccessReport();
+#endif
 	static QString getGlobalPath();
 	static QString getOverridePath();
 	static QString getOptionName(int identifier);
@@ -311,7 +326,13 @@ public:
 protected:
 	explicit SettingsManager(QObject *parent);
 
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+	static void addAccessStatistics(AccessStatistics *statistics, bool hasUrl, qint64 time);
+	static void recordAccess(int identifier, quintptr caller, bool hasUrl, qint64 time);
+	static QString getCallerName(quintptr caller);
+#endif
 	static QString getHost(const QUrl &url);
+	static QVariant readOption(int identifier, const QUrl &url);
 	static void registerOption(int identifier, OptionType type, const QVariant &defaultValue = {}, const QStringList &choices = {});
 
 private:
@@ -320,6 +341,14 @@ private:
 	static QString m_overridePath;
 	static QVector<OptionDefinition> m_definitions;
 	static QHash<QString, int> m_customOptions;
+	static QHash<QString, QHash<int, QVariant> > m_overrides;
+	static QVector<QVariant> m_globalOptions;
+	static QReadWriteLock m_optionsLock;
+#ifdef OTTER_ENABLE_SETTINGS_PROFILING
+	static QHash<int, AccessStatistics> m_optionsStatistics;
+	static QHash<quintptr, AccessStatistics> m_callersStatistics;
+	static QMutex m_statisticsMutex;
+#endif
 	static int m_identifierCounter;
 	static int m_optionIdentifierEnumerator;
 	static bool m_hasWildcardedOverrides;
@@ -19,6 +19,7 @@
 
 #include "TransfersManager.h"
 #include "Application.h"
+#include "Console.h"
 #include "NetworkManager.h"
 #include "NetworkManagerFactory.h"
 #include "NotificationsManager.h"
@@ -26,12 +27,14 @@
 #include "Utils.h"
 #include "../ui/MainWindow.h"
 
+#include <QtCore/QDataStream>
 #include <QtCore/QDir>
 #include <QtCore/QMimeDatabase>
 #include <QtCore/QRegularExpression>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QTemporaryFile>
 #include <QtCore/QTimer>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtNetwork/QAbstractNetworkCache>
 #include <QtWidgets/QMessageBox>
 
@@ -40,61 +43,113 @@ namespace Otter
 
 TransfersManager* TransfersManager::m_instance(nullptr);
 QVector<Transfer*> TransfersManager::m_transfers;
-QVector<Transfer*> TransfersManager::m_privateTransfers;
+QSet<Transfer*> TransfersManager::m_privateTransfers;
+QHash<Transfer*, quint64> TransfersManager::m_identifiers;
+quint64 TransfersManager::m_identifier(0);
 bool TransfersManager::m_isInitilized(false);
 
 Transfer::Transfer(TransferOptions options, QObject *parent) : QObject(parent ? parent : TransfersManager::getInstance()),
 	m_reply(nullptr),
 	m_device(nullptr),
+	m_sourceDevice(nullptr),
+	m_writeWatcher(nullptr),
+	m_targetWatcher(nullptr),
+	m_hash(QCryptographicHash::Sha256),
 	m_speed(0),
 	m_bytesStart(0),
 	m_bytesReceivedDifference(0),
 	m_bytesReceived(0),
 	m_bytesTotal(0),
+	m_bytesPending(0),
+	m_bytesWriting(0),
+	m_writePosition(0),
+	m_hashPosition(0),
+	m_deviceSize(-1),
+	m_isCopyAborted(0),
 	m_options(options),
 	m_state(UnknownState),
 	m_updateTimer(0),
 	m_updateInterval(0),
-	m_isSelectingPath(false)
+	m_isSelectingPath(false),
+	m_isWriting(false),
+	m_isFinishPending(false)
 {
 }
 
 Transfer::Transfer(const QSettings &settings, QObject *parent) : QObject(parent ? parent : TransfersManager::getInstance()),
 	m_reply(nullptr),
 	m_device(nullptr),
+	m_sourceDevice(nullptr),
+	m_writeWatcher(nullptr),
+	m_targetWatcher(nullptr),
 	m_source(settings.value(QLatin1String("source")).toUrl()),
 	m_target(settings.value(QLatin1String("target")).toString()),
 	m_timeStarted(settings.value(QLatin1String("timeStarted")).toDateTime()),
 	m_timeFinished(settings.value(QLatin1String("timeFinished")).toDateTime()),
-	m_mimeType(QMimeDatabase().mimeTypeForFile(m_target)),
+	m_mimeType(QMimeDatabase().mimeTypeForFile(m_target, QMimeDatabase::MatchExtension)),
+	m_checksum(settings.value(QLatin1String("checksum")).toString().toLatin1()),
+	m_hash(QCryptographicHash::Sha256),
 	m_speed(0),
 	m_bytesStart(0),
 	m_bytesReceivedDifference(0),
 	m_bytesReceived(settings.value(QLatin1String("bytesReceived")).toLongLong()),
 	m_bytesTotal(settings.value(QLatin1String("bytesTotal")).toLongLong()),
+	m_bytesPending(0),
+	m_bytesWriting(0),
+	m_writePosition(0),
+	m_hashPosition(0),
+	m_deviceSize(-1),
+	m_isCopyAborted(0),
 	m_options(NoOption),
 	m_state((m_bytesReceived > 0 && m_bytesTotal == m_bytesReceived) ? FinishedState : ErrorState),
 	m_updateTimer(0),
 	m_updateInterval(0),
-	m_isSelectingPath(false)
+	m_isSelectingPath(false),
+	m_isWriting(false),
+	m_isFinishPending(false)
 {
+	const QStringList segments(settings.value(QLatin1String("segments")).toStringList());
+
+	for (int i = 0; i < segments.count(); ++i)
+	{
+		TransferSegment segment;
+		segment.position = segments.at(i).section(QLatin1Char('-'), 0, 0).toLongLong();
+		segment.end = segments.at(i).section(QLatin1Char('-'), 1, 1).toLongLong();
+
+		if (segment.position <= segment.end && segment.end <= m_bytesTotal)
+		{
+			m_segments.append(segment);
+		}
+	}
 }
 
 Transfer::Transfer(const QUrl &source, const QString &target, TransferOptions options, QObject *parent) : QObject(parent ? parent : TransfersManager::getInstance()),
 	m_reply(nullptr),
 	m_device(nullptr),
+	m_sourceDevice(nullptr),
+	m_writeWatcher(nullptr),
+	m_targetWatcher(nullptr),
 	m_source(source),
 	m_target(target),
+	m_hash(QCryptographicHash::Sha256),
 	m_speed(0),
 	m_bytesStart(0),
 	m_bytesReceivedDifference(0),
 	m_bytesReceived(0),
 	m_bytesTotal(0),
+	m_bytesPending(0),
+	m_bytesWriting(0),
+	m_writePosition(0),
+	m_hashPosition(0),
+	m_deviceSize(-1),
+	m_isCopyAborted(0),
 	m_options(options),
 	m_state(UnknownState),
 	m_updateTimer(0),
 	m_updateInterval(0),
-	m_isSelectingPath(false)
+	m_isSelectingPath(false),
+	m_isWriting(false),
+	m_isFinishPending(false)
 {
 	QNetworkRequest request;
 	request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
@@ -107,42 +162,70 @@ Transfer::Transfer(const QUrl &source, const QString &target, TransferOptions op
 Transfer::Transfer(const QNetworkRequest &request, const QString &target, TransferOptions options, QObject *parent) : QObject(parent ? parent : TransfersManager::getInstance()),
 	m_reply(nullptr),
 	m_device(nullptr),
+	m_sourceDevice(nullptr),
+	m_writeWatcher(nullptr),
+	m_targetWatcher(nullptr),
 	m_source(request.url()),
 	m_target(target),
+	m_hash(QCryptographicHash::Sha256),
 	m_speed(0),
 	m_bytesStart(0),
 	m_bytesReceivedDifference(0),
 	m_bytesReceived(0),
 	m_bytesTotal(0),
+	m_bytesPending(0),
+	m_bytesWriting(0),
+	m_writePosition(0),
+	m_hashPosition(0),
+	m_deviceSize(-1),
+	m_isCopyAborted(0),
 	m_options(options),
 	m_state(UnknownState),
 	m_updateTimer(0),
 	m_updateInterval(0),
-	m_isSelectingPath(false)
+	m_isSelectingPath(false),
+	m_isWriting(false),
+	m_isFinishPending(false)
 {
 	start(NetworkManagerFactory::getNetworkManager()->get(request), target);
 }
 
 Transfer::Transfer(QNetworkReply *reply, const QString &target, TransferOptions options, QObject *parent) : QObject(parent ? parent : TransfersManager::getInstance()),
 	m_reply(reply),
+	m_writeWatcher(nullptr),
+	m_targetWatcher(nullptr),
 	m_source((m_reply->url().isValid() ? m_reply->url() : m_reply->request().url()).adjusted(QUrl::RemovePassword | QUrl::PreferLocalFile)),
 	m_target(target),
+	m_hash(QCryptographicHash::Sha256),
 	m_speed(0),
 	m_bytesStart(0),
 	m_bytesReceivedDifference(0),
 	m_bytesReceived(0),
 	m_bytesTotal(0),
+	m_bytesPending(0),
+	m_bytesWriting(0),
+	m_writePosition(0),
+	m_hashPosition(0),
+	m_deviceSize(-1),
+	m_isCopyAborted(0),
 	m_options(options),
 	m_state(UnknownState),
 	m_updateTimer(0),
 	m_updateInterval(0),
-	m_isSelectingPath(false)
+	m_isSelectingPath(false),
+	m_isWriting(false),
+	m_isFinishPending(false)
 {
 	start(reply, target);
 }
 
 Transfer::~Transfer()
 {
+	if (m_writeWatcher)
+	{
+		m_writeWatcher->waitForFinished();
+	}
+
 	if (m_options.testFlag(HasToOpenAfterFinishOption) && QFile::exists(m_target))
 	{
 		QFile::remove(m_target);
@@ -244,6 +327,7 @@ void Transfer::start(QNetworkReply *reply, const QString &target)
 		connect(m_reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(downloadProgress(qint64,qint64)));
 		connect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
 		connect(m_reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(downloadError(QNetworkReply::NetworkError)));
+		connect(m_reply, SIGNAL(metaDataChanged()), this, SLOT(startSegments()));
 	}
 	else
 	{
@@ -255,6 +339,8 @@ void Transfer::start(QNetworkReply *reply, const QString &target)
 		}
 	}
 
+	flushData();
+
 	m_device->reset();
 
 	m_mimeType = QMimeDatabase().mimeTypeForData(m_device);
@@ -347,9 +433,279 @@ void Transfer::start(QNetworkReply *reply, const QString &target)
 		}
 		else
 		{
-			m_mimeType = QMimeDatabase().mimeTypeForFile(m_target);
+			updateTargetInformation();
+		}
+	}
+}
+
+void Transfer::startSegment(int index)
+{
+	QNetworkRequest request;
+	request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+	request.setHeader(QNetworkRequest::UserAgentHeader, NetworkManagerFactory::getUserAgent());
+	request.setRawHeader(QStringLiteral("Range").toLatin1(), QStringLiteral("bytes=%1-%2").arg(m_segments.at(index).position).arg(m_segments.at(index).end - 1).toLatin1());
+	request.setUrl(m_source);
+
+	QNetworkReply *reply(NetworkManagerFactory::getNetworkManager()->get(request));
+
+	m_segments[index].reply = reply;
+
+	connect(reply, SIGNAL(readyRead()), this, SLOT(downloadSegmentData()));
+	connect(reply, SIGNAL(finished()), this, SLOT(downloadSegmentData()));
+}
+
+void Transfer::stopSegment(int index)
+{
+	QNetworkReply *reply(m_segments.at(index).reply);
+
+	if (!reply)
+	{
+		return;
+	}
+
+	m_segments[index].reply = nullptr;
+
+	disconnect(reply, SIGNAL(readyRead()), this, SLOT(downloadSegmentData()));
+	disconnect(reply, SIGNAL(finished()), this, SLOT(downloadSegmentData()));
+
+	reply->abort();
+
+	QTimer::singleShot(250, reply, SLOT(deleteLater()));
+}
+
+void Transfer::writeSegmentData(int index)
+{
+	QNetworkReply *reply(m_segments.at(index).reply);
+
+	if (!reply || !m_device)
+	{
+		return;
+	}
+
+	if (reply->request().hasRawHeader(QStringLiteral("Range").toLatin1()) && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid() && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
+	{
+		if (!reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isNull())
+		{
+			m_source = m_source.resolved(reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl());
+		}
+
+		m_chunks.clear();
+
+		m_bytesPending = 0;
+
+		if (!restart())
+		{
+			downloadError(QNetworkReply::UnknownContentError);
+		}
+
+		return;
+	}
+
+	if (!reply->isFinished() && (m_bytesPending + m_bytesWriting) >= MaximumBufferSize)
+	{
+		reply->setReadBufferSize(MaximumBufferSize);
+
+		return;
+	}
+
+	const qint64 limit(m_segments.at(index).end - m_segments.at(index).position);
+	const QByteArray data(reply->read(reply->isFinished() ? limit : qMin(limit, (MaximumBufferSize - (m_bytesPending + m_bytesWriting)))));
+
+	if (!data.isEmpty())
+	{
+		writeData(m_segments.at(index).position, data);
+
+		m_segments[index].position += data.size();
+		m_bytesReceived += data.size();
+		m_bytesReceivedDifference += data.size();
+	}
+
+	if (m_segments.at(index).position >= m_segments.at(index).end)
+	{
+		stopSegment(index);
+	}
+	else if (reply->isFinished() && reply->bytesAvailable() == 0)
+	{
+		downloadError(reply->error());
+
+		return;
+	}
+
+	bool isFinished(true);
+
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		if (m_segments.at(i).position < m_segments.at(i).end)
+		{
+			isFinished = false;
+
+			break;
 		}
 	}
+
+	if (!data.isEmpty())
+	{
+		emit progressChanged(m_bytesReceived, m_bytesTotal);
+	}
+
+	if (isFinished && m_state == RunningState)
+	{
+		finishSegments();
+	}
+}
+
+void Transfer::writeData(qint64 position, const QByteArray &data)
+{
+	if (data.isEmpty())
+	{
+		return;
+	}
+
+	TransferChunk chunk;
+	chunk.data = data;
+	chunk.position = position;
+
+	m_chunks.append(chunk);
+
+	m_bytesPending += data.size();
+
+	scheduleWrite();
+}
+
+void Transfer::scheduleWrite()
+{
+	if (!m_device || m_isWriting || (m_chunks.isEmpty() && !m_sourceDevice && m_deviceSize < 0))
+	{
+		return;
+	}
+
+	if (!m_writeWatcher)
+	{
+		m_writeWatcher = new QFutureWatcher<bool>(this);
+
+		connect(m_writeWatcher, SIGNAL(finished()), this, SLOT(handleWriteFinished()));
+	}
+
+	TransferWrite write;
+	write.chunks = m_chunks;
+	write.device = m_device.data();
+	write.source = m_sourceDevice.data();
+	write.isAborted = &m_isCopyAborted;
+	write.size = m_deviceSize;
+
+	m_bytesWriting = m_bytesPending;
+	m_bytesPending = 0;
+	m_deviceSize = -1;
+	m_isWriting = true;
+
+	m_writeWatcher->setFuture(QtConcurrent::run(&Transfer::writeChunks, write, &m_hash, &m_hashPosition));
+
+	m_chunks.clear();
+}
+
+void Transfer::discardSegments()
+{
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		stopSegment(i);
+	}
+
+	m_chunks.clear();
+	m_segments.clear();
+
+	m_bytesPending = 0;
+	m_deviceSize = 0;
+
+	scheduleWrite();
+
+	m_bytesReceived = 0;
+	m_writePosition = 0;
+}
+
+void Transfer::abortCopy()
+{
+	if (!m_sourceDevice)
+	{
+		return;
+	}
+
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		stopSegment(i);
+	}
+
+	m_isCopyAborted.storeRelease(1);
+
+	m_chunks.clear();
+	m_segments.clear();
+
+	m_bytesPending = 0;
+	m_deviceSize = -1;
+	m_isFinishPending = false;
+}
+
+void Transfer::finishSegments()
+{
+	if (m_updateTimer != 0)
+	{
+		killTimer(m_updateTimer);
+
+		m_updateTimer = 0;
+	}
+
+	if (!flushData())
+	{
+		discardSegments();
+		stop();
+
+		return;
+	}
+
+	m_segments.clear();
+
+	if (m_device)
+	{
+		m_device->close();
+		m_device->deleteLater();
+		m_device = nullptr;
+	}
+
+	markFinished();
+
+	m_state = FinishedState;
+	m_bytesReceived = m_bytesTotal;
+
+	updateTargetInformation();
+
+	emit finished();
+	emit changed();
+
+	if (m_options.testFlag(HasToOpenAfterFinishOption))
+	{
+		openTarget();
+	}
+
+	if (m_options.testFlag(CanAutoDeleteOption) && !m_isSelectingPath)
+	{
+		deleteLater();
+	}
+}
+
+void Transfer::updateTargetInformation()
+{
+	flushData();
+
+	m_mimeType = QMimeDatabase().mimeTypeForFile(m_target, QMimeDatabase::MatchExtension);
+	m_checksum.clear();
+
+	if (!m_targetWatcher)
+	{
+		m_targetWatcher = new QFutureWatcher<TargetInformation>(this);
+
+		connect(m_targetWatcher, SIGNAL(finished()), this, SLOT(handleTargetInformationLoaded()));
+	}
+
+	m_targetWatcher->setFuture(QtConcurrent::run(&Transfer::getTargetInformation, m_target, ((m_hashPosition > 0) ? m_hash.result().toHex() : QByteArray()), m_hashPosition));
 }
 
 void Transfer::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
@@ -374,14 +730,24 @@ void Transfer::downloadData()
 
 		if (m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid() && m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
 		{
-			m_device->reset();
+			m_writePosition = 0;
 		}
 	}
 
-	m_device->write(m_reply->readAll());
-	m_device->seek(m_device->size());
+	if (!m_reply->isFinished() && (m_bytesPending + m_bytesWriting) >= MaximumBufferSize)
+	{
+		m_reply->setReadBufferSize(MaximumBufferSize);
+
+		return;
+	}
+
+	const QByteArray data(m_reply->isFinished() ? m_reply->readAll() : m_reply->read(MaximumBufferSize - (m_bytesPending + m_bytesWriting)));
+
+	writeData(m_writePosition, data);
+
+	m_writePosition += data.size();
 
-	if (m_state == RunningState && m_reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool() && m_bytesTotal >= 0 && m_device->size() == m_bytesTotal)
+	if (m_state == RunningState && m_reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool() && m_bytesTotal >= 0 && m_writePosition == m_bytesTotal)
 	{
 		downloadFinished();
 	}
@@ -393,6 +759,8 @@ void Transfer::downloadFinished()
 	{
 		if (m_device && !m_device->inherits(QStringLiteral("QTemporaryFile").toLatin1()))
 		{
+			flushData();
+
 			m_device->close();
 			m_device->deleteLater();
 			m_device = nullptr;
@@ -415,6 +783,13 @@ void Transfer::downloadFinished()
 		return;
 	}
 
+	if (m_sourceDevice)
+	{
+		m_isFinishPending = true;
+
+		return;
+	}
+
 	if (m_updateTimer != 0)
 	{
 		killTimer(m_updateTimer);
@@ -424,13 +799,19 @@ void Transfer::downloadFinished()
 
 	if (m_reply->size() > 0)
 	{
-		m_device->write(m_reply->readAll());
+		const QByteArray data(m_reply->readAll());
+
+		writeData(m_writePosition, data);
+
+		m_writePosition += data.size();
 	}
 
 	disconnect(m_reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(downloadProgress(qint64,qint64)));
 	disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadData()));
 	disconnect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
 
+	flushData();
+
 	m_bytesReceived = (m_device ? m_device->size() : -1);
 
 	if (m_bytesTotal <= 0 && m_bytesReceived > 0)
@@ -447,7 +828,8 @@ void Transfer::downloadFinished()
 		markFinished();
 
 		m_state = FinishedState;
-		m_mimeType = QMimeDatabase().mimeTypeForFile(m_target);
+
+		updateTargetInformation();
 	}
 
 	emit finished();
@@ -490,6 +872,16 @@ void Transfer::downloadError(QNetworkReply::NetworkError error)
 	}
 }
 
+void Transfer::downloadSegmentData()
+{
+	const int index(getSegmentIndex(qobject_cast<QNetworkReply*>(sender())));
+
+	if (index >= 0)
+	{
+		writeSegmentData(index);
+	}
+}
+
 void Transfer::markStarted()
 {
 	m_timeStarted = QDateTime::currentDateTime();
@@ -500,73 +892,219 @@ void Transfer::markFinished(bool reset)
 	m_timeFinished = (reset ? QDateTime() : QDateTime::currentDateTime());
 }
 
-void Transfer::openTarget()
+void Transfer::startSegments()
 {
-	Utils::runApplication(m_openCommand, QUrl::fromLocalFile(getTarget()));
-}
+	if (!m_reply || !m_device || !m_segments.isEmpty() || m_state != RunningState || m_bytesStart > 0 || m_device->inherits(QStringLiteral("QTemporaryFile").toLatin1()) || m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200 || m_reply->hasRawHeader(QStringLiteral("Content-Encoding").toLatin1()) || !m_reply->rawHeader(QStringLiteral("Accept-Ranges").toLatin1()).contains("bytes"))
+	{
+		return;
+	}
 
-void Transfer::cancel()
-{
-	m_state = CancelledState;
+	const qint64 position(m_writePosition);
+	const qint64 bytesTotal(m_reply->header(QNetworkRequest::ContentLengthHeader).toLongLong());
 
-	if (m_reply)
+	if ((bytesTotal - position) < (SegmentsAmount * MinimumSegmentSize))
 	{
-		m_reply->abort();
-
-		QTimer::singleShot(250, m_reply, SLOT(deleteLater()));
+		return;
 	}
 
-	if (m_device)
+	m_deviceSize = bytesTotal;
+
+	scheduleWrite();
+
+	const qint64 segmentSize((bytesTotal - position) / SegmentsAmount);
+
+	disconnect(m_reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(downloadProgress(qint64,qint64)));
+	disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadData()));
+	disconnect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
+	disconnect(m_reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(downloadError(QNetworkReply::NetworkError)));
+	disconnect(m_reply, SIGNAL(metaDataChanged()), this, SLOT(startSegments()));
+
+	m_segments.reserve(SegmentsAmount);
+
+	for (int i = 0; i < SegmentsAmount; ++i)
 	{
-		m_device->remove();
+		TransferSegment segment;
+		segment.position = (position + (i * segmentSize));
+		segment.end = ((i == (SegmentsAmount - 1)) ? bytesTotal : (segment.position + segmentSize));
+
+		m_segments.append(segment);
 	}
 
-	stop();
+	m_segments[0].reply = m_reply;
+	m_bytesReceived = position;
+	m_bytesTotal = bytesTotal;
 
-	if (m_options.testFlag(CanAutoDeleteOption) && !m_isSelectingPath)
+	connect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadSegmentData()));
+	connect(m_reply, SIGNAL(finished()), this, SLOT(downloadSegmentData()));
+
+	m_reply = nullptr;
+
+	for (int i = 1; i < m_segments.count(); ++i)
 	{
-		deleteLater();
+		startSegment(i);
 	}
+
+	writeSegmentData(0);
 }
 
-void Transfer::stop()
+void Transfer::handleWriteFinished()
 {
-	if (m_updateTimer != 0)
+	if (!m_isWriting)
 	{
-		killTimer(m_updateTimer);
-
-		m_updateTimer = 0;
+		return;
 	}
 
-	if (m_reply)
-	{
-		m_reply->abort();
+	const bool isFinishPending(m_isFinishPending);
 
-		QTimer::singleShot(250, m_reply, SLOT(deleteLater()));
-	}
+	m_bytesWriting = 0;
+	m_isWriting = false;
+	m_isFinishPending = false;
 
-	if (m_device && !m_device->inherits(QStringLiteral("QTemporaryFile").toLatin1()))
+	if (m_sourceDevice)
 	{
-		m_device->close();
-		m_device->deleteLater();
-		m_device = nullptr;
+		m_sourceDevice->close();
+		m_sourceDevice->deleteLater();
+		m_sourceDevice = nullptr;
 	}
 
-	if (m_state == RunningState)
+	if (!m_writeWatcher->result())
 	{
-		m_state = ErrorState;
+		if (m_segments.isEmpty())
+		{
+			m_chunks.clear();
 
-		if (m_options.testFlag(CanAutoDeleteOption) && !m_isSelectingPath)
+			m_bytesPending = 0;
+		}
+		else
 		{
-			deleteLater();
+			discardSegments();
 		}
+
+		downloadError(QNetworkReply::UnknownContentError);
+
+		return;
 	}
 
-	emit stopped();
-	emit changed();
-}
+	scheduleWrite();
 
-void Transfer::setOpenCommand(const QString &command)
+	if (isFinishPending)
+	{
+		downloadFinished();
+
+		return;
+	}
+
+	if (m_state == RunningState)
+	{
+		downloadData();
+
+		for (int i = 0; i < m_segments.count(); ++i)
+		{
+			writeSegmentData(i);
+		}
+	}
+}
+
+void Transfer::handleTargetInformationLoaded()
+{
+	const TargetInformation information(m_targetWatcher->result());
+
+	m_mimeType = information.mimeType;
+	m_checksum = information.checksum;
+
+	emit changed();
+}
+
+void Transfer::openTarget()
+{
+	Utils::runApplication(m_openCommand, QUrl::fromLocalFile(getTarget()));
+}
+
+void Transfer::cancel()
+{
+	m_state = CancelledState;
+
+	if (m_reply)
+	{
+		m_reply->abort();
+
+		QTimer::singleShot(250, m_reply, SLOT(deleteLater()));
+	}
+
+	abortCopy();
+
+	m_chunks.clear();
+
+	m_bytesPending = 0;
+
+	flushData();
+
+	if (m_device)
+	{
+		m_device->remove();
+	}
+
+	stop();
+
+	m_segments.clear();
+
+	if (m_options.testFlag(CanAutoDeleteOption) && !m_isSelectingPath)
+	{
+		deleteLater();
+	}
+}
+
+void Transfer::stop()
+{
+	if (m_updateTimer != 0)
+	{
+		killTimer(m_updateTimer);
+
+		m_updateTimer = 0;
+	}
+
+	if (m_reply)
+	{
+		m_reply->abort();
+
+		QTimer::singleShot(250, m_reply, SLOT(deleteLater()));
+	}
+
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		stopSegment(i);
+	}
+
+	abortCopy();
+
+	if (!flushData() && !m_segments.isEmpty())
+	{
+		discardSegments();
+		flushData();
+	}
+
+	if (m_device && !m_device->inherits(QStringLiteral("QTemporaryFile").toLatin1()))
+	{
+		m_device->close();
+		m_device->deleteLater();
+		m_device = nullptr;
+	}
+
+	if (m_state == RunningState)
+	{
+		m_state = ErrorState;
+
+		if (m_options.testFlag(CanAutoDeleteOption) && !m_isSelectingPath)
+		{
+			deleteLater();
+		}
+	}
+
+	emit stopped();
+	emit changed();
+}
+
+void Transfer::setOpenCommand(const QString &command)
 {
 	m_openCommand = command;
 
@@ -692,6 +1230,11 @@ QMimeType Transfer::getMimeType() const
 	return m_mimeType;
 }
 
+QByteArray Transfer::getChecksum() const
+{
+	return m_checksum;
+}
+
 qint64 Transfer::getSpeed() const
 {
 	return m_speed;
@@ -707,6 +1250,64 @@ qint64 Transfer::getBytesTotal() const
 	return m_bytesTotal;
 }
 
+Transfer::TargetInformation Transfer::getTargetInformation(const QString &path, const QByteArray &checksum, qint64 checksumSize)
+{
+	TargetInformation information;
+	information.mimeType = QMimeDatabase().mimeTypeForFile(path);
+
+	if (!checksum.isEmpty() && QFileInfo(path).size() == checksumSize)
+	{
+		information.checksum = checksum;
+
+		return information;
+	}
+
+	QFile file(path);
+
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QCryptographicHash hash(QCryptographicHash::Sha256);
+
+		if (hash.addData(&file))
+		{
+			information.checksum = hash.result().toHex();
+		}
+	}
+
+	return information;
+}
+
+int Transfer::getSegmentIndex(QNetworkReply *reply) const
+{
+	if (!reply)
+	{
+		return -1;
+	}
+
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		if (m_segments.at(i).reply == reply)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+QVector<QPair<qint64, qint64> > Transfer::getSegments() const
+{
+	QVector<QPair<qint64, qint64> > segments;
+	segments.reserve(m_segments.count());
+
+	for (int i = 0; i < m_segments.count(); ++i)
+	{
+		segments.append(qMakePair(m_segments.at(i).position, m_segments.at(i).end));
+	}
+
+	return segments;
+}
+
 Transfer::TransferOptions Transfer::getOptions() const
 {
 	return m_options;
@@ -717,6 +1318,99 @@ Transfer::TransferState Transfer::getState() const
 	return m_state;
 }
 
+bool Transfer::writeChunk(QFile *device, QCryptographicHash *hash, qint64 *hashPosition, const TransferChunk &chunk)
+{
+	if (!device->seek(chunk.position) || device->write(chunk.data) != chunk.data.size())
+	{
+		return false;
+	}
+
+	if (*hashPosition == chunk.position)
+	{
+		hash->addData(chunk.data);
+
+		*hashPosition += chunk.data.size();
+	}
+	else
+	{
+		*hashPosition = -1;
+	}
+
+	return true;
+}
+
+bool Transfer::writeChunks(const TransferWrite &write, QCryptographicHash *hash, qint64 *hashPosition)
+{
+	if (write.source)
+	{
+		TransferChunk chunk;
+
+		if (!write.source->reset())
+		{
+			return false;
+		}
+
+		while (!write.source->atEnd())
+		{
+			if (write.isAborted->loadAcquire() != 0)
+			{
+				return false;
+			}
+
+			chunk.data = write.source->read(MaximumBufferSize);
+
+			if (chunk.data.isEmpty() || !writeChunk(write.device, hash, hashPosition, chunk))
+			{
+				return false;
+			}
+
+			chunk.position += chunk.data.size();
+		}
+	}
+
+	if (write.size >= 0 && !write.device->resize(write.size))
+	{
+		return false;
+	}
+
+	for (int i = 0; i < write.chunks.count(); ++i)
+	{
+		if (!writeChunk(write.device, hash, hashPosition, write.chunks.at(i)))
+		{
+			return false;
+		}
+	}
+
+	return write.device->flush();
+}
+
+bool Transfer::flushData()
+{
+	bool isSuccess(true);
+
+	while (m_isWriting)
+	{
+		m_writeWatcher->waitForFinished();
+
+		isSuccess = (m_writeWatcher->result() && isSuccess);
+
+		m_bytesWriting = 0;
+		m_isWriting = false;
+		m_isFinishPending = false;
+
+		if (m_sourceDevice)
+		{
+			m_sourceDevice->close();
+			m_sourceDevice->deleteLater();
+			m_sourceDevice = nullptr;
+		}
+
+		scheduleWrite();
+	}
+
+	return isSuccess;
+}
+
 bool Transfer::resume()
 {
 	if (m_state != ErrorState || !QFile::exists(m_target))
@@ -731,7 +1425,7 @@ bool Transfer::resume()
 
 	QFile *file(new QFile(m_target));
 
-	if (!file->open(QIODevice::WriteOnly | QIODevice::Append))
+	if (!file->open(m_segments.isEmpty() ? (QIODevice::WriteOnly | QIODevice::Append) : QIODevice::OpenMode(QIODevice::ReadWrite)))
 	{
 		file->deleteLater();
 
@@ -742,6 +1436,29 @@ bool Transfer::resume()
 	m_device = file;
 	m_timeStarted = QDateTime::currentDateTime();
 	m_timeFinished = QDateTime();
+	m_writePosition = file->size();
+	m_hashPosition = 0;
+
+	m_hash.reset();
+
+	if (!m_segments.isEmpty())
+	{
+		for (int i = 0; i < m_segments.count(); ++i)
+		{
+			if (m_segments.at(i).position < m_segments.at(i).end)
+			{
+				startSegment(i);
+			}
+		}
+
+		if (m_updateTimer == 0 && m_updateInterval > 0)
+		{
+			m_updateTimer = startTimer(m_updateInterval);
+		}
+
+		return true;
+	}
+
 	m_bytesStart = file->size();
 
 	QNetworkRequest request;
@@ -758,6 +1475,7 @@ bool Transfer::resume()
 	connect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadData()));
 	connect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
 	connect(m_reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(downloadError(QNetworkReply::NetworkError)));
+	connect(m_reply, SIGNAL(metaDataChanged()), this, SLOT(startSegments()));
 
 	if (m_updateTimer == 0 && m_updateInterval > 0)
 	{
@@ -771,6 +1489,8 @@ bool Transfer::restart()
 {
 	stop();
 
+	m_segments.clear();
+
 	QFile *file(new QFile(m_target));
 
 	if (!file->open(QIODevice::WriteOnly))
@@ -785,6 +1505,10 @@ bool Transfer::restart()
 	m_timeStarted = QDateTime::currentDateTime();
 	m_timeFinished = QDateTime();
 	m_bytesStart = 0;
+	m_writePosition = 0;
+	m_hashPosition = 0;
+
+	m_hash.reset();
 
 	QNetworkRequest request;
 	request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
@@ -799,6 +1523,7 @@ bool Transfer::restart()
 	connect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadData()));
 	connect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
 	connect(m_reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(downloadError(QNetworkReply::NetworkError)));
+	connect(m_reply, SIGNAL(metaDataChanged()), this, SLOT(startSegments()));
 
 	if (m_updateTimer == 0 && m_updateInterval > 0)
 	{
@@ -810,7 +1535,7 @@ bool Transfer::restart()
 
 bool Transfer::setTarget(const QString &target, bool canOverwriteExisting)
 {
-	if (m_target == target)
+	if (m_target == target || !m_segments.isEmpty())
 	{
 		return false;
 	}
@@ -878,40 +1603,46 @@ bool Transfer::setTarget(const QString &target, bool canOverwriteExisting)
 
 	m_target = mutableTarget;
 
-	if (m_device)
+	if (m_reply && m_state == RunningState)
 	{
-		if (m_reply && m_state == RunningState)
-		{
-			disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadData()));
-		}
+		disconnect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadData()));
+	}
 
-		m_device->reset();
+	flushData();
 
-		file->write(m_device->readAll());
+	m_sourceDevice = m_device;
+	m_device = file;
+	m_writePosition = m_sourceDevice->size();
+	m_hashPosition = 0;
 
-		m_device->close();
-		m_device->deleteLater();
-	}
+	m_hash.reset();
+	m_isCopyAborted.storeRelease(0);
 
-	m_device = file;
+	m_isFinishPending = (!m_reply || m_reply->isFinished());
 
+	scheduleWrite();
 	downloadData();
 
-	if (!m_reply || m_reply->isFinished())
-	{
-		downloadFinished();
-	}
-	else
+	if (m_reply && !m_reply->isFinished())
 	{
 		connect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadData()));
+
+		startSegments();
 	}
 
 	return false;
 }
 
 TransfersManager::TransfersManager(QObject *parent) : QObject(parent),
-	m_saveTimer(0)
+	m_saveTimer(0),
+	m_journalRecords(0),
+	m_limitPeriod(0),
+	m_isEnabled(false)
 {
+	handleOptionChanged(SettingsManager::History_RememberDownloadsOption);
+	handleOptionChanged(SettingsManager::History_DownloadsLimitPeriodOption);
+
+	connect(SettingsManager::getInstance(), SIGNAL(optionChanged(int,QVariant)), this, SLOT(handleOptionChanged(int)));
 }
 
 void TransfersManager::createInstance()
@@ -934,18 +1665,125 @@ void TransfersManager::timerEvent(QTimerEvent *event)
 	}
 }
 
-void TransfersManager::scheduleSave()
+void TransfersManager::scheduleSave(Transfer *transfer)
 {
+	if (m_privateTransfers.contains(transfer))
+	{
+		return;
+	}
+
+	if (!m_modifiedTransfers.contains(transfer))
+	{
+		m_modifiedTransfers.append(transfer);
+	}
+
 	if (m_saveTimer == 0)
 	{
 		m_saveTimer = startTimer(1000);
 	}
 }
 
+void TransfersManager::writeRecord(const QByteArray &record)
+{
+	if (SessionsManager::isReadOnly() || !m_isEnabled)
+	{
+		return;
+	}
+
+	if (!m_journalFile.isOpen())
+	{
+		m_journalFile.setFileName(getJournalPath());
+
+		if (!m_journalFile.open(QIODevice::WriteOnly | QIODevice::Append))
+		{
+			Console::addMessage(tr("Failed to open transfers journal: %1").arg(m_journalFile.errorString()), Console::OtherCategory, Console::ErrorLevel, getJournalPath());
+
+			return;
+		}
+	}
+
+	m_journalFile.write(record);
+	m_journalFile.flush();
+
+	++m_journalRecords;
+}
+
+void TransfersManager::replayJournal(QSettings &history)
+{
+	QFile file(getJournalPath());
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_4);
+
+	while (!stream.atEnd())
+	{
+		QVariantMap information;
+		quint64 identifier(0);
+		quint8 type(UnknownRecord);
+
+		stream >> type >> identifier;
+
+		if (type == UpdateRecord)
+		{
+			stream >> information;
+		}
+
+		if (stream.status() != QDataStream::Ok || (type != UpdateRecord && type != RemoveRecord))
+		{
+			Console::addMessage(tr("Failed to read transfers journal, last records were skipped"), Console::OtherCategory, Console::WarningLevel, getJournalPath());
+
+			break;
+		}
+
+		if (type == UpdateRecord)
+		{
+			writeTransfer(history, identifier, information);
+		}
+		else
+		{
+			history.remove(QString::number(identifier));
+		}
+
+		++m_journalRecords;
+	}
+}
+
+void TransfersManager::writeTransfer(QSettings &history, quint64 identifier, const QVariantMap &information)
+{
+	history.beginGroup(QString::number(identifier));
+	history.remove(QString());
+
+	QVariantMap::const_iterator iterator;
+
+	for (iterator = information.constBegin(); iterator != information.constEnd(); ++iterator)
+	{
+		history.setValue(iterator.key(), iterator.value());
+	}
+
+	history.endGroup();
+}
+
 void TransfersManager::addTransfer(Transfer *transfer)
 {
+	if (!m_isInitilized)
+	{
+		getTransfers();
+	}
+
 	m_transfers.append(transfer);
 
+	if (!m_identifiers.contains(transfer))
+	{
+		++m_identifier;
+
+		m_identifiers[transfer] = m_identifier;
+	}
+
 	transfer->setUpdateInterval(500);
 
 	connect(transfer, SIGNAL(started()), m_instance, SLOT(transferStarted()));
@@ -965,41 +1803,93 @@ void TransfersManager::addTransfer(Transfer *transfer)
 
 	if (transfer->getOptions().testFlag(Transfer::IsPrivateOption))
 	{
-		m_privateTransfers.append(transfer);
+		m_privateTransfers.insert(transfer);
 	}
 }
 
 void TransfersManager::save()
 {
-	if (SessionsManager::isReadOnly() || SettingsManager::getOption(SettingsManager::Browser_PrivateModeOption).toBool() || !SettingsManager::getOption(SettingsManager::History_RememberDownloadsOption).toBool())
+	if (SessionsManager::isReadOnly() || !m_isEnabled)
+	{
+		m_modifiedTransfers.clear();
+
+		return;
+	}
+
+	for (int i = 0; i < m_modifiedTransfers.count(); ++i)
+	{
+		Transfer *transfer(m_modifiedTransfers.at(i));
+		const QVariantMap information(getTransferInformation(transfer));
+
+		if (transfer->getState() == Transfer::RunningState)
+		{
+			QVariantMap progress(information);
+			progress.remove(QLatin1String("timeFinished"));
+			progress.remove(QLatin1String("bytesReceived"));
+			progress.remove(QLatin1String("segments"));
+
+			if (m_journaledProgress.value(transfer) == progress)
+			{
+				continue;
+			}
+
+			m_journaledProgress[transfer] = progress;
+		}
+		else
+		{
+			m_journaledProgress.remove(transfer);
+		}
+
+		QByteArray record;
+		QDataStream stream(&record, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_4);
+		stream << static_cast<quint8>(UpdateRecord) << m_identifiers.value(transfer) << information;
+
+		writeRecord(record);
+	}
+
+	m_modifiedTransfers.clear();
+
+	if (m_journalRecords > qMax(100, m_transfers.count()))
+	{
+		compact();
+	}
+}
+
+void TransfersManager::compact()
+{
+	if (SessionsManager::isReadOnly() || !m_isEnabled)
 	{
 		return;
 	}
 
+	m_journalFile.close();
+
 	QSettings history(SessionsManager::getWritableDataPath(QLatin1String("transfers.ini")), QSettings::IniFormat);
 	history.clear();
 
-	const int limit(SettingsManager::getOption(SettingsManager::History_DownloadsLimitPeriodOption).toInt());
-	int entry(1);
-
 	for (int i = 0; i < m_transfers.count(); ++i)
 	{
-		if (m_privateTransfers.contains(m_transfers.at(i)) || (m_transfers.at(i)->getState() == Transfer::FinishedState && m_transfers.at(i)->getTimeFinished().isValid() && m_transfers.at(i)->getTimeFinished().daysTo(QDateTime::currentDateTime()) > limit))
+		Transfer *transfer(m_transfers.at(i));
+
+		if (m_privateTransfers.contains(transfer) || (transfer->getState() == Transfer::FinishedState && transfer->getTimeFinished().isValid() && transfer->getTimeFinished().daysTo(QDateTime::currentDateTime()) > m_limitPeriod))
 		{
 			continue;
 		}
 
-		history.setValue(QStringLiteral("%1/source").arg(entry), m_transfers.at(i)->getSource().toString());
-		history.setValue(QStringLiteral("%1/target").arg(entry), m_transfers.at(i)->getTarget());
-		history.setValue(QStringLiteral("%1/timeStarted").arg(entry), m_transfers.at(i)->getTimeStarted().toString(Qt::ISODate));
-		history.setValue(QStringLiteral("%1/timeFinished").arg(entry), ((m_transfers.at(i)->getTimeFinished().isValid() && m_transfers.at(i)->getState() != Transfer::RunningState) ? m_transfers.at(i)->getTimeFinished() : QDateTime::currentDateTime()).toString(Qt::ISODate));
-		history.setValue(QStringLiteral("%1/bytesTotal").arg(entry), m_transfers.at(i)->getBytesTotal());
-		history.setValue(QStringLiteral("%1/bytesReceived").arg(entry), m_transfers.at(i)->getBytesReceived());
-
-		++entry;
+		writeTransfer(history, m_identifiers.value(transfer), getTransferInformation(transfer));
 	}
 
 	history.sync();
+
+	if (history.status() == QSettings::NoError)
+	{
+		QFile::remove(getJournalPath());
+
+		m_journalRecords = 0;
+	}
+
+	m_modifiedTransfers.clear();
 }
 
 void TransfersManager::transferStarted()
@@ -1010,7 +1900,7 @@ void TransfersManager::transferStarted()
 	{
 		emit transferStarted(transfer);
 
-		scheduleSave();
+		scheduleSave(transfer);
 	}
 }
 
@@ -1027,10 +1917,7 @@ void TransfersManager::transferFinished()
 
 		emit transferFinished(transfer);
 
-		if (!m_privateTransfers.contains(transfer))
-		{
-			scheduleSave();
-		}
+		scheduleSave(transfer);
 	}
 }
 
@@ -1042,7 +1929,7 @@ void TransfersManager::transferChanged()
 	{
 		emit transferChanged(transfer);
 
-		scheduleSave();
+		scheduleSave(transfer);
 	}
 }
 
@@ -1054,7 +1941,25 @@ void TransfersManager::transferStopped()
 	{
 		emit transferStopped(transfer);
 
-		scheduleSave();
+		scheduleSave(transfer);
+	}
+}
+
+void TransfersManager::handleOptionChanged(int identifier)
+{
+	switch (identifier)
+	{
+		case SettingsManager::Browser_PrivateModeOption:
+		case SettingsManager::History_RememberDownloadsOption:
+			m_isEnabled = (SettingsManager::getOption(SettingsManager::History_RememberDownloadsOption).toBool() && !SettingsManager::getOption(SettingsManager::Browser_PrivateModeOption).toBool());
+
+			break;
+		case SettingsManager::History_DownloadsLimitPeriodOption:
+			m_limitPeriod = SettingsManager::getOption(SettingsManager::History_DownloadsLimitPeriodOption).toInt();
+
+			break;
+		default:
+			break;
 	}
 }
 
@@ -1074,6 +1979,44 @@ TransfersManager* TransfersManager::getInstance()
 	return m_instance;
 }
 
+QString TransfersManager::getJournalPath() const
+{
+	return SessionsManager::getWritableDataPath(QLatin1String("transfers.journal"));
+}
+
+QVariantMap TransfersManager::getTransferInformation(Transfer *transfer)
+{
+	QVariantMap information;
+	information[QLatin1String("source")] = transfer->getSource().toString();
+	information[QLatin1String("target")] = transfer->getTarget();
+	information[QLatin1String("timeStarted")] = transfer->getTimeStarted().toString(Qt::ISODate);
+	information[QLatin1String("timeFinished")] = ((transfer->getTimeFinished().isValid() && transfer->getState() != Transfer::RunningState) ? transfer->getTimeFinished() : QDateTime::currentDateTime()).toString(Qt::ISODate);
+	information[QLatin1String("bytesTotal")] = transfer->getBytesTotal();
+	information[QLatin1String("bytesReceived")] = transfer->getBytesReceived();
+
+	const QVector<QPair<qint64, qint64> > segments(transfer->getSegments());
+
+	if (!segments.isEmpty())
+	{
+		QStringList ranges;
+		ranges.reserve(segments.count());
+
+		for (int i = 0; i < segments.count(); ++i)
+		{
+			ranges.append(QStringLiteral("%1-%2").arg(segments.at(i).first).arg(segments.at(i).second));
+		}
+
+		information[QLatin1String("segments")] = ranges;
+	}
+
+	if (!transfer->getChecksum().isEmpty())
+	{
+		information[QLatin1String("checksum")] = QString(transfer->getChecksum());
+	}
+
+	return information;
+}
+
 Transfer* TransfersManager::startTransfer(const QUrl &source, const QString &target, Transfer::TransferOptions options)
 {
 	Transfer *transfer(new Transfer(source, target, options, m_instance));
@@ -1126,7 +2069,15 @@ QVector<Transfer*> TransfersManager::getTransfers()
 {
 	if (!m_isInitilized)
 	{
+		m_isInitilized = true;
+
 		QSettings history(SessionsManager::getWritableDataPath(QLatin1String("transfers.ini")), QSettings::IniFormat);
+
+		if (!SessionsManager::isReadOnly())
+		{
+			m_instance->replayJournal(history);
+		}
+
 		const QStringList entries(history.childGroups());
 
 		m_transfers.reserve(entries.count());
@@ -1137,15 +2088,29 @@ QVector<Transfer*> TransfersManager::getTransfers()
 
 			if (!history.value(QLatin1String("source")).toString().isEmpty() && !history.value(QLatin1String("target")).toString().isEmpty())
 			{
-				addTransfer(new Transfer(history, m_instance));
+				Transfer *transfer(new Transfer(history, m_instance));
+				const quint64 identifier(entries.at(i).toULongLong());
+
+				if (identifier > 0)
+				{
+					m_identifiers[transfer] = identifier;
+					m_identifier = qMax(m_identifier, identifier);
+				}
+
+				addTransfer(transfer);
 			}
 
 			history.endGroup();
 		}
 
-		m_isInitilized = true;
+		if (m_instance->m_journalRecords > 0)
+		{
+			history.sync();
 
-		connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), m_instance, SLOT(save()));
+			m_instance->compact();
+		}
+
+		connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), m_instance, SLOT(compact()));
 	}
 
 	return m_transfers;
@@ -1158,9 +2123,22 @@ bool TransfersManager::removeTransfer(Transfer *transfer, bool keepFile)
 		return false;
 	}
 
+	if (!m_privateTransfers.contains(transfer))
+	{
+		QByteArray record;
+		QDataStream stream(&record, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_4);
+		stream << static_cast<quint8>(RemoveRecord) << m_identifiers.value(transfer);
+
+		m_instance->writeRecord(record);
+	}
+
 	m_transfers.removeAll(transfer);
+	m_instance->m_modifiedTransfers.removeAll(transfer);
+	m_instance->m_journaledProgress.remove(transfer);
 
-	m_privateTransfers.removeAll(transfer);
+	m_privateTransfers.remove(transfer);
+	m_identifiers.remove(transfer);
 
 	if (transfer->getState() == Transfer::RunningState)
 	{
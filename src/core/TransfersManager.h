@@ -20,9 +20,13 @@
 #ifndef OTTER_TRANSFERSMANAGER_H
 #define OTTER_TRANSFERSMANAGER_H
 
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QCryptographicHash>
 #include <QtCore/QFile>
+#include <QtCore/QFutureWatcher>
 #include <QtCore/QMimeType>
 #include <QtCore/QPointer>
+#include <QtCore/QSet>
 #include <QtCore/QSettings>
 #include <QtNetwork/QNetworkReply>
 
@@ -59,6 +63,17 @@ public:
 		CancelledState = 4
 	};
 
+	enum SegmentLimit
+	{
+		SegmentsAmount = 4,
+		MinimumSegmentSize = 4194304
+	};
+
+	enum BufferLimit
+	{
+		MaximumBufferSize = 2097152
+	};
+
 	explicit Transfer(TransferOptions options = CanAskForPathOption, QObject *parent = nullptr);
 	Transfer(const QSettings &settings, QObject *parent = nullptr);
 	Transfer(const QUrl &source, const QString &target = {}, TransferOptions options = CanAskForPathOption, QObject *parent = nullptr);
@@ -73,9 +88,11 @@ public:
 	virtual QDateTime getTimeStarted() const;
 	virtual QDateTime getTimeFinished() const;
 	virtual QMimeType getMimeType() const;
+	QByteArray getChecksum() const;
 	virtual qint64 getSpeed() const;
 	virtual qint64 getBytesReceived() const;
 	virtual qint64 getBytesTotal() const;
+	QVector<QPair<qint64, qint64> > getSegments() const;
 	TransferOptions getOptions() const;
 	virtual TransferState getState() const;
 
@@ -89,20 +106,69 @@ public slots:
 	virtual bool setTarget(const QString &target, bool canOverwriteExisting = false);
 
 protected:
+	struct TransferChunk
+	{
+		QByteArray data;
+		qint64 position = 0;
+	};
+
+	struct TransferWrite
+	{
+		QVector<TransferChunk> chunks;
+		QFile *device = nullptr;
+		QFile *source = nullptr;
+		QAtomicInt *isAborted = nullptr;
+		qint64 size = -1;
+	};
+
+	struct TransferSegment
+	{
+		QPointer<QNetworkReply> reply;
+		qint64 position = 0;
+		qint64 end = 0;
+	};
+
+	struct TargetInformation
+	{
+		QMimeType mimeType;
+		QByteArray checksum;
+	};
+
 	void timerEvent(QTimerEvent *event) override;
 	void start(QNetworkReply *reply, const QString &target);
+	void startSegment(int index);
+	void stopSegment(int index);
+	void writeSegmentData(int index);
+	void writeData(qint64 position, const QByteArray &data);
+	void scheduleWrite();
+	void discardSegments();
+	void abortCopy();
+	void finishSegments();
+	void updateTargetInformation();
+	static TargetInformation getTargetInformation(const QString &path, const QByteArray &checksum, qint64 checksumSize);
+	int getSegmentIndex(QNetworkReply *reply) const;
+	static bool writeChunk(QFile *device, QCryptographicHash *hash, qint64 *hashPosition, const TransferChunk &chunk);
+	static bool writeChunks(const TransferWrite &write, QCryptographicHash *hash, qint64 *hashPosition);
+	bool flushData();
 
 protected slots:
 	void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
 	void downloadData();
 	void downloadFinished();
 	void downloadError(QNetworkReply::NetworkError error);
+	void downloadSegmentData();
 	void markStarted();
 	void markFinished(bool reset = false);
+	void startSegments();
+	void handleWriteFinished();
+	void handleTargetInformationLoaded();
 
 private:
 	QPointer<QNetworkReply> m_reply;
 	QPointer<QFile> m_device;
+	QPointer<QFile> m_sourceDevice;
+	QFutureWatcher<bool> *m_writeWatcher;
+	QFutureWatcher<TargetInformation> *m_targetWatcher;
 	QUrl m_source;
 	QString m_target;
 	QString m_openCommand;
@@ -110,16 +176,28 @@ private:
 	QDateTime m_timeStarted;
 	QDateTime m_timeFinished;
 	QMimeType m_mimeType;
+	QByteArray m_checksum;
+	QCryptographicHash m_hash;
+	QVector<TransferChunk> m_chunks;
+	QVector<TransferSegment> m_segments;
 	qint64 m_speed;
 	qint64 m_bytesStart;
 	qint64 m_bytesReceivedDifference;
 	qint64 m_bytesReceived;
 	qint64 m_bytesTotal;
+	qint64 m_bytesPending;
+	qint64 m_bytesWriting;
+	qint64 m_writePosition;
+	qint64 m_hashPosition;
+	qint64 m_deviceSize;
+	QAtomicInt m_isCopyAborted;
 	TransferOptions m_options;
 	TransferState m_state;
 	int m_updateTimer;
 	int m_updateInterval;
 	bool m_isSelectingPath;
+	bool m_isWriting;
+	bool m_isFinishPending;
 
 signals:
 	void progressChanged(qint64 bytesReceived, qint64 bytesTotal);
@@ -146,24 +224,46 @@ public:
 	static bool isDownloading(const QString &source, const QString &target = {});
 
 protected:
+	enum JournalRecordType
+	{
+		UnknownRecord = 0,
+		UpdateRecord = 1,
+		RemoveRecord = 2
+	};
+
 	explicit TransfersManager(QObject *parent);
 
 	void timerEvent(QTimerEvent *event) override;
-	void scheduleSave();
+	void scheduleSave(Transfer *transfer);
+	void writeRecord(const QByteArray &record);
+	void replayJournal(QSettings &history);
+	static void writeTransfer(QSettings &history, quint64 identifier, const QVariantMap &information);
+	QString getJournalPath() const;
+	static QVariantMap getTransferInformation(Transfer *transfer);
 
 protected slots:
 	void save();
+	void compact();
 	void transferStarted();
 	void transferFinished();
 	void transferChanged();
 	void transferStopped();
+	void handleOptionChanged(int identifier);
 
 private:
+	QFile m_journalFile;
+	QVector<Transfer*> m_modifiedTransfers;
+	QHash<Transfer*, QVariantMap> m_journaledProgress;
 	int m_saveTimer;
+	int m_journalRecords;
+	int m_limitPeriod;
+	bool m_isEnabled;
 
 	static TransfersManager *m_instance;
 	static QVector<Transfer*> m_transfers;
-	static QVector<Transfer*> m_privateTransfers;
+	static QSet<Transfer*> m_privateTransfers;
+	static QHash<Transfer*, quint64> m_identifiers;
+	static quint64 m_identifier;
 	static bool m_isInitilized;
 
 signals:
@@ -522,6 +522,23 @@ QStringList getOpenPaths(const QStringList &fileNames, QStringList filters, bool
 	return paths;
 }
 
+QStringList createUrlMatchKeys(const QUrl &url)
+{
+	QStringList keys({url.toString().toLower()});
+	const QString address(url.toString(QUrl::RemoveScheme).mid(2).toLower());
+
+	keys.append(address);
+
+	if (address.startsWith(QLatin1String("www.")) && url.host().count(QLatin1Char('.')) > 1)
+	{
+		keys.append(address.mid(4));
+	}
+
+	keys.removeDuplicates();
+
+	return keys;
+}
+
 QVector<QUrl> extractUrls(const QMimeData *mimeData)
 {
 	if (mimeData->property("x-url-string").isNull())
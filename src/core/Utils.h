@@ -98,6 +98,7 @@ QUrl normalizeUrl(QUrl url);
 QPixmap loadPixmapFromDataUri(const QString &data);
 SaveInformation getSavePath(const QString &fileName, QString path = {}, QStringList filters = {}, bool forceAsk = false);
 QStringList getOpenPaths(const QStringList &fileNames = {}, QStringList filters = {}, bool selectMultiple = false);
+QStringList createUrlMatchKeys(const QUrl &url);
 QVector<QUrl> extractUrls(const QMimeData *mimeData);
 QVector<ApplicationInformation> getApplicationsForMimeType(const QMimeType &mimeType);
 bool isUrlEmpty(const QUrl &url);
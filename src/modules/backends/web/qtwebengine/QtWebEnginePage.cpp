@@ -19,6 +19,7 @@
 **************************************************************************/
 
 #include "QtWebEnginePage.h"
+#include "QtWebEngineUrlRequestInterceptor.h"
 #include "QtWebEngineWebBackend.h"
 #include "QtWebEngineWebWidget.h"
 #include "../../../../core/Console.h"
@@ -29,6 +30,8 @@
 #include "../../../../ui/ContentsDialog.h"
 
 #include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
 #include <QtCore/QRegularExpression>
 #include <QtGui/QDesktopServices>
 #include <QtWebEngineWidgets/QWebEngineProfile>
@@ -53,7 +56,18 @@ QtWebEnginePage::QtWebEnginePage(bool isPrivate, QtWebEngineWebWidget *parent) :
 		connect(profile(), SIGNAL(downloadRequested(QWebEngineDownloadItem*)), m_widget->getBackend(), SLOT(downloadFile(QWebEngineDownloadItem*)));
 	}
 
+	if (!isPrivate && m_widget)
+	{
+		m_requestInterceptor = qobject_cast<QtWebEngineWebBackend*>(m_widget->getBackend())->m_requestInterceptor;
+	}
+
 	connect(this, SIGNAL(loadFinished(bool)), this, SLOT(pageLoadFinished()));
+	connect(this, SIGNAL(urlChanged(QUrl)), this, SLOT(handleUrlChanged(QUrl)));
+}
+
+QtWebEnginePage::~QtWebEnginePage()
+{
+	setBlockedElementsDomain(QString());
 }
 
 void QtWebEnginePage::pageLoadFinished()
@@ -65,39 +79,24 @@ void QtWebEnginePage::pageLoadFinished()
 		if (m_widget)
 		{
 			const QVector<int> profiles(ContentBlockingManager::getProfileList(m_widget->getOption(SettingsManager::ContentBlocking_ProfilesOption, url()).toStringList()));
+			const ContentBlockingManager::CosmeticFiltersResult cosmeticFilters(ContentBlockingManager::getCosmeticFilters(profiles, url()));
 
-			if (!profiles.isEmpty() && ContentBlockingManager::getCosmeticFiltersMode() != ContentBlockingManager::NoFiltersMode)
+			if (cosmeticFilters.mode == ContentBlockingManager::AllFiltersMode || !cosmeticFilters.rules.isEmpty() || !cosmeticFilters.exceptions.isEmpty())
 			{
-				const ContentBlockingManager::CosmeticFiltersMode mode(ContentBlockingManager::checkUrl(profiles, url(), url(), NetworkManager::OtherType).comesticFiltersMode);
-				QStringList styleSheetBlackList;
-				QStringList styleSheetWhiteList;
+				QFile file(QLatin1String(":/modules/backends/web/qtwebengine/resources/hideElements.js"));
 
-				if (mode != ContentBlockingManager::NoFiltersMode)
+				if (file.open(QIODevice::ReadOnly))
 				{
-					if (mode != ContentBlockingManager::DomainOnlyFiltersMode)
-					{
-						styleSheetBlackList = ContentBlockingManager::getStyleSheet(profiles);
-					}
-
-					const QStringList domainList(ContentBlockingManager::createSubdomainList(url().host()));
+					const bool hasStyleSheet(cosmeticFilters.mode == ContentBlockingManager::AllFiltersMode);
 
-					for (int i = 0; i < domainList.count(); ++i)
+					if (hasStyleSheet)
 					{
-						styleSheetBlackList += ContentBlockingManager::getStyleSheetBlackList(domainList.at(i), profiles);
-						styleSheetWhiteList += ContentBlockingManager::getStyleSheetWhiteList(domainList.at(i), profiles);
+						runJavaScript(ContentBlockingManager::getStyleSheetScript(profiles));
 					}
-				}
 
-				if (!styleSheetBlackList.isEmpty() || !styleSheetWhiteList.isEmpty())
-				{
-					QFile file(QLatin1String(":/modules/backends/web/qtwebengine/resources/hideElements.js"));
+					runJavaScript(QString(file.readAll()).arg(createJsonList(cosmeticFilters.exceptions), createJsonList(cosmeticFilters.rules), (hasStyleSheet ? QLatin1String("contentBlockingStyleSheet") : QLatin1String("[]"))));
 
-					if (file.open(QIODevice::ReadOnly))
-					{
-						runJavaScript(QString(file.readAll()).arg(createJavaScriptList(styleSheetWhiteList)).arg(createJavaScriptList(styleSheetBlackList)));
-
-						file.close();
-					}
+					file.close();
 				}
 			}
 
@@ -158,11 +157,36 @@ void QtWebEnginePage::removePopup(const QUrl &url)
 	emit requestedPopupWindow(requestedUrl(), url);
 }
 
+void QtWebEnginePage::handleUrlChanged(const QUrl &url)
+{
+	setBlockedElementsDomain(url.host());
+}
+
 void QtWebEnginePage::markAsPopup()
 {
 	m_isPopup = true;
 }
 
+void QtWebEnginePage::setBlockedElementsDomain(const QString &domain)
+{
+	if (!m_requestInterceptor || domain == m_blockedElementsDomain)
+	{
+		return;
+	}
+
+	if (!domain.isEmpty())
+	{
+		m_requestInterceptor->retainBlockedElements(domain);
+	}
+
+	if (!m_blockedElementsDomain.isEmpty())
+	{
+		m_requestInterceptor->releaseBlockedElements(m_blockedElementsDomain);
+	}
+
+	m_blockedElementsDomain = domain;
+}
+
 void QtWebEnginePage::javaScriptAlert(const QUrl &url, const QString &message)
 {
 	if (m_isIgnoringJavaScriptPopups)
@@ -268,6 +292,11 @@ QString QtWebEnginePage::createJavaScriptList(QStringList rules) const
 	return QStringLiteral("'%1'").arg(rules.join("','"));
 }
 
+QString QtWebEnginePage::createJsonList(const QStringList &rules) const
+{
+	return QString::fromUtf8(QJsonDocument(QJsonArray::fromStringList(rules)).toJson(QJsonDocument::Compact));
+}
+
 QStringList QtWebEnginePage::chooseFiles(QWebEnginePage::FileSelectionMode mode, const QStringList &oldFiles, const QStringList &acceptedMimeTypes)
 {
 	Q_UNUSED(acceptedMimeTypes)
@@ -370,6 +399,13 @@ bool QtWebEnginePage::acceptNavigationRequest(const QUrl &url, QWebEnginePage::N
 			this->scripts().insert(script);
 		}
 
+		if (m_requestInterceptor)
+		{
+			m_requestInterceptor->prepareContentBlockingProfiles(url);
+		}
+
+		setBlockedElementsDomain(url.host());
+
 		emit aboutToNavigate(url, type);
 	}
 
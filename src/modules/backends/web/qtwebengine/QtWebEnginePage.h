@@ -23,11 +23,13 @@
 
 #include "../../../../core/SessionsManager.h"
 
+#include <QtCore/QPointer>
 #include <QtWebEngineWidgets/QWebEnginePage>
 
 namespace Otter
 {
 
+class QtWebEngineUrlRequestInterceptor;
 class QtWebEngineWebWidget;
 class WebWidget;
 
@@ -37,16 +39,19 @@ class QtWebEnginePage final : public QWebEnginePage
 
 public:
 	explicit QtWebEnginePage(bool isPrivate, QtWebEngineWebWidget *parent);
+	~QtWebEnginePage();
 
 	bool isPopup() const;
 	bool isViewingMedia() const;
 
 protected:
 	void markAsPopup();
+	void setBlockedElementsDomain(const QString &domain);
 	void javaScriptAlert(const QUrl &url, const QString &message) override;
 	void javaScriptConsoleMessage(JavaScriptConsoleMessageLevel level, const QString &note, int line, const QString &source) override;
 	QWebEnginePage* createWindow(WebWindowType type) override;
 	QString createJavaScriptList(QStringList rules) const;
+	QString createJsonList(const QStringList &rules) const;
 	QStringList chooseFiles(FileSelectionMode mode, const QStringList &oldFiles, const QStringList &acceptedMimeTypes) override;
 	bool acceptNavigationRequest(const QUrl &url, QWebEnginePage::NavigationType type, bool isMainFrame) override;
 	bool javaScriptConfirm(const QUrl &url, const QString &message) override;
@@ -55,10 +60,13 @@ protected:
 protected slots:
 	void pageLoadFinished();
 	void removePopup(const QUrl &url);
+	void handleUrlChanged(const QUrl &url);
 
 private:
 	QtWebEngineWebWidget *m_widget;
+	QPointer<QtWebEngineUrlRequestInterceptor> m_requestInterceptor;
 	QVector<QtWebEnginePage*> m_popups;
+	QString m_blockedElementsDomain;
 	QWebEnginePage::NavigationType m_previousNavigationType;
 	bool m_isIgnoringJavaScriptPopups;
 	bool m_isViewingMedia;
@@ -25,7 +25,6 @@
 #include "../../../../core/SettingsManager.h"
 
 #include <QtCore/QCoreApplication>
-#include <QtCore/QTimer>
 
 namespace Otter
 {
@@ -33,24 +32,22 @@ namespace Otter
 QtWebEngineUrlRequestInterceptor::QtWebEngineUrlRequestInterceptor(QObject *parent) : QWebEngineUrlRequestInterceptor(parent),
 	m_areImagesEnabled(SettingsManager::getOption(SettingsManager::Permissions_EnableImagesOption).toString() != QLatin1String("disabled"))
 {
-	QTimer::singleShot(1800000, this, SLOT(clearContentBlockingInformation()));
-
 	connect(SettingsManager::getInstance(), SIGNAL(optionChanged(int,QVariant)), this, SLOT(handleOptionChanged(int)));
 	connect(SettingsManager::getInstance(), SIGNAL(optionChanged(int,QVariant,QUrl)), this, SLOT(handleOptionChanged(int)));
 }
 
 void QtWebEngineUrlRequestInterceptor::clearContentBlockingInformation()
 {
-	m_blockedElements.clear();
-	m_contentBlockingProfiles.clear();
+	QWriteLocker locker(&m_contentBlockingProfilesLock);
 
-	QTimer::singleShot(1800000, this, SLOT(clearContentBlockingInformation()));
+	m_contentBlockingProfiles.clear();
 }
 
 void QtWebEngineUrlRequestInterceptor::handleOptionChanged(int identifier)
 {
 	switch (identifier)
 	{
+		case SettingsManager::ContentBlocking_EnableContentBlockingOption:
 		case SettingsManager::ContentBlocking_ProfilesOption:
 			clearContentBlockingInformation();
 
@@ -64,9 +61,72 @@ void QtWebEngineUrlRequestInterceptor::handleOptionChanged(int identifier)
 	}
 }
 
+void QtWebEngineUrlRequestInterceptor::prepareContentBlockingProfiles(const QUrl &url)
+{
+	getContentBlockingProfiles(url);
+}
+
+void QtWebEngineUrlRequestInterceptor::retainBlockedElements(const QString &domain)
+{
+	QMutexLocker locker(&m_blockedElementsMutex);
+
+	++m_pagesDomains[domain];
+}
+
+void QtWebEngineUrlRequestInterceptor::releaseBlockedElements(const QString &domain)
+{
+	QMutexLocker locker(&m_blockedElementsMutex);
+
+	if (m_pagesDomains.contains(domain) && --m_pagesDomains[domain] <= 0)
+	{
+		m_pagesDomains.remove(domain);
+		m_blockedElements.remove(domain);
+	}
+}
+
 QStringList QtWebEngineUrlRequestInterceptor::getBlockedElements(const QString &domain) const
 {
-	return m_blockedElements.value(domain);
+	QMutexLocker locker(&m_blockedElementsMutex);
+
+	return m_blockedElements.value(domain).toList();
+}
+
+QVector<int> QtWebEngineUrlRequestInterceptor::getContentBlockingProfiles(const QUrl &url)
+{
+	const QString host(url.host());
+
+	m_contentBlockingProfilesLock.lockForRead();
+
+	QHash<QString, QVector<int> >::const_iterator iterator(m_contentBlockingProfiles.constFind(host));
+
+	if (iterator != m_contentBlockingProfiles.constEnd())
+	{
+		const QVector<int> profiles(iterator.value());
+
+		m_contentBlockingProfilesLock.unlock();
+
+		return profiles;
+	}
+
+	m_contentBlockingProfilesLock.unlock();
+
+	QVector<int> profiles;
+
+	if (SettingsManager::getOption(SettingsManager::ContentBlocking_EnableContentBlockingOption, url).toBool())
+	{
+		profiles = ContentBlockingManager::getProfileList(SettingsManager::getOption(SettingsManager::ContentBlocking_ProfilesOption, url).toStringList());
+	}
+
+	QWriteLocker locker(&m_contentBlockingProfilesLock);
+
+	if (m_contentBlockingProfiles.count() >= 1000)
+	{
+		m_contentBlockingProfiles.clear();
+	}
+
+	m_contentBlockingProfiles[host] = profiles;
+
+	return profiles;
 }
 
 void QtWebEngineUrlRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo &request)
@@ -78,19 +138,7 @@ void QtWebEngineUrlRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo
 		return;
 	}
 
-	if (!m_contentBlockingProfiles.contains(request.firstPartyUrl().host()))
-	{
-		if (SettingsManager::getOption(SettingsManager::ContentBlocking_EnableContentBlockingOption, request.firstPartyUrl()).toBool())
-		{
-			m_contentBlockingProfiles[request.firstPartyUrl().host()] = ContentBlockingManager::getProfileList(SettingsManager::getOption(SettingsManager::ContentBlocking_ProfilesOption, request.firstPartyUrl()).toStringList());
-		}
-		else
-		{
-			m_contentBlockingProfiles[request.firstPartyUrl().host()] = QVector<int>();
-		}
-	}
-
-	const QVector<int> contentBlockingProfiles(m_contentBlockingProfiles.value(request.firstPartyUrl().host()));
+	const QVector<int> contentBlockingProfiles(getContentBlockingProfiles(request.firstPartyUrl()));
 
 	if (contentBlockingProfiles.isEmpty())
 	{
@@ -155,9 +203,15 @@ void QtWebEngineUrlRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo
 
 	if (result.isBlocked)
 	{
-		if (storeBlockedUrl && !m_blockedElements.value(request.firstPartyUrl().host()).contains(request.requestUrl().url()))
+		if (storeBlockedUrl)
 		{
-			m_blockedElements[request.firstPartyUrl().host()].append(request.requestUrl().url());
+			const QString host(request.firstPartyUrl().host());
+			QMutexLocker locker(&m_blockedElementsMutex);
+
+			if (m_pagesDomains.contains(host))
+			{
+				m_blockedElements[host].insert(request.requestUrl().url());
+			}
 		}
 
 		Console::addMessage(QCoreApplication::translate("main", "Request blocked with rule: %1").arg(result.rule), Console::NetworkCategory, Console::LogLevel, request.requestUrl().toString(), -1);
@@ -21,7 +21,10 @@
 #ifndef OTTER_QTWEBENGINEURLREQUESTINTERCEPTOR_H
 #define OTTER_QTWEBENGINEURLREQUESTINTERCEPTOR_H
 
-#include <QtCore/QMap>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QSet>
 #include <QtCore/QVector>
 #include <QtWebEngineCore/QWebEngineUrlRequestInterceptor>
 
@@ -35,16 +38,25 @@ class QtWebEngineUrlRequestInterceptor final : public QWebEngineUrlRequestInterc
 public:
 	explicit QtWebEngineUrlRequestInterceptor(QObject *parent = nullptr);
 
+	void prepareContentBlockingProfiles(const QUrl &url);
+	void retainBlockedElements(const QString &domain);
+	void releaseBlockedElements(const QString &domain);
 	QStringList getBlockedElements(const QString &domain) const;
 	void interceptRequest(QWebEngineUrlRequestInfo &request) override;
 
+protected:
+	QVector<int> getContentBlockingProfiles(const QUrl &url);
+
 protected slots:
 	void clearContentBlockingInformation();
 	void handleOptionChanged(int identifier);
 
 private:
-	QMap<QString, QStringList> m_blockedElements;
-	QMap<QString, QVector<int> > m_contentBlockingProfiles;
+	QHash<QString, QSet<QString> > m_blockedElements;
+	QHash<QString, QVector<int> > m_contentBlockingProfiles;
+	QHash<QString, int> m_pagesDomains;
+	mutable QMutex m_blockedElementsMutex;
+	QReadWriteLock m_contentBlockingProfilesLock;
 	bool m_areImagesEnabled;
 };
 
@@ -1,5 +1,5 @@
-var whitelist = [%1];
-var blacklist = [%2];
+var whitelist = %1;
+var blacklist = %2.concat(%3);
 var ignoredElements = [];
 
 for (var i = 0; i < whitelist.length; ++i)
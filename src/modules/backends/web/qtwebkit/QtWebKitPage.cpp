@@ -135,27 +135,16 @@ void QtWebKitFrame::handleLoadFinished()
 	const QUrl url(m_widget->getUrl());
 	const QVector<int> profiles(ContentBlockingManager::getProfileList(m_widget->getOption(SettingsManager::ContentBlocking_ProfilesOption, url).toStringList()));
 
-	if (!profiles.isEmpty() && ContentBlockingManager::getCosmeticFiltersMode() != ContentBlockingManager::NoFiltersMode)
-	{
-		const ContentBlockingManager::CosmeticFiltersMode mode(ContentBlockingManager::checkUrl(profiles, url, url, NetworkManager::OtherType).comesticFiltersMode);
-
-		if (mode != ContentBlockingManager::NoFiltersMode)
-		{
-			if (mode != ContentBlockingManager::DomainOnlyFiltersMode)
-			{
-				applyContentBlockingRules(ContentBlockingManager::getStyleSheet(profiles), true);
-			}
-
-			const QStringList domainList(ContentBlockingManager::createSubdomainList(url.host()));
+	const ContentBlockingManager::CosmeticFiltersResult cosmeticFilters(ContentBlockingManager::getCosmeticFilters(profiles, url));
 
-			for (int i = 0; i < domainList.count(); ++i)
-			{
-				applyContentBlockingRules(ContentBlockingManager::getStyleSheetBlackList(domainList.at(i), profiles), true);
-				applyContentBlockingRules(ContentBlockingManager::getStyleSheetWhiteList(domainList.at(i), profiles), false);
-			}
-		}
+	if (cosmeticFilters.mode == ContentBlockingManager::AllFiltersMode)
+	{
+		applyContentBlockingRules(ContentBlockingManager::getStyleSheet(profiles), true);
 	}
 
+	applyContentBlockingRules(cosmeticFilters.rules, true);
+	applyContentBlockingRules(cosmeticFilters.exceptions, false);
+
 	const QStringList blockedRequests(m_widget->getBlockedElements());
 
 	if (blockedRequests.count() > 0)
@@ -113,28 +113,45 @@ void ErrorConsoleWidget::showEvent(QShowEvent *event)
 		m_model = new QStandardItemModel(this);
 		m_model->setSortRole(TimeRole);
 
-		const QVector<Console::Message> messages(Console::getMessages());
-
-		for (int i = 0; i < messages.count(); ++i)
-		{
-			addMessage(messages.at(i));
-		}
+		addMessages(Console::getMessages());
 
 		m_ui->consoleView->setModel(m_model);
 
-		connect(Console::getInstance(), SIGNAL(messageAdded(Console::Message)), this, SLOT(addMessage(Console::Message)));
+		connect(Console::getInstance(), SIGNAL(messagesAdded(QVector<Console::Message>)), this, SLOT(addMessages(QVector<Console::Message>)));
 	}
 
 	QWidget::showEvent(event);
 }
 
-void ErrorConsoleWidget::addMessage(const Console::Message &message)
+void ErrorConsoleWidget::addMessages(const QVector<Console::Message> &messages)
 {
-	if (!m_model)
+	if (!m_model || messages.isEmpty())
 	{
 		return;
 	}
 
+	QVector<QStandardItem*> messageItems;
+	messageItems.reserve(messages.count());
+
+	for (int i = 0; i < messages.count(); ++i)
+	{
+		messageItems.append(addMessage(messages.at(i)));
+	}
+
+	m_model->sort(0, Qt::DescendingOrder);
+
+	const QString filter(m_ui->filterLineEdit->text());
+	const QVector<Console::MessageCategory> categories(getCategories());
+	const quint64 currentWindow(getCurrentWindow());
+
+	for (int i = 0; i < messageItems.count(); ++i)
+	{
+		applyFilters(messageItems.at(i)->index(), filter, categories, currentWindow);
+	}
+}
+
+QStandardItem* ErrorConsoleWidget::addMessage(const Console::Message &message)
+{
 	QIcon icon;
 	QString category;
 
@@ -197,9 +214,8 @@ void ErrorConsoleWidget::addMessage(const Console::Message &message)
 	}
 
 	m_model->appendRow(messageItem);
-	m_model->sort(0, Qt::DescendingOrder);
 
-	applyFilters(messageItem->index(), m_ui->filterLineEdit->text(), getCategories(), getCurrentWindow());
+	return messageItem;
 }
 
 void ErrorConsoleWidget::clear()
@@ -62,11 +62,12 @@ protected:
 
 	void showEvent(QShowEvent *event) override;
 	void applyFilters(const QModelIndex &index, const QString &filter, const QVector<Console::MessageCategory> &categories, quint64 currentWindow);
+	QStandardItem* addMessage(const Console::Message &message);
 	QVector<Console::MessageCategory> getCategories() const;
 	quint64 getCurrentWindow();
 
 protected slots:
-	void addMessage(const Console::Message &message);
+	void addMessages(const QVector<Console::Message> &messages);
 	void clear();
 	void copyText();
 	void filterCategories();
@@ -64,9 +64,11 @@ HistoryContentsWidget::HistoryContentsWidget(const QVariantMap &parameters, Wind
 	QTimer::singleShot(100, this, SLOT(populateEntries()));
 
 	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(cleared()), this, SLOT(populateEntries()));
-	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(entryAdded(HistoryEntryItem*)), this, SLOT(addEntry(HistoryEntryItem*)));
-	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(entryModified(HistoryEntryItem*)), this, SLOT(modifyEntry(HistoryEntryItem*)));
-	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(entryRemoved(HistoryEntryItem*)), this, SLOT(removeEntry(HistoryEntryItem*)));
+	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(loaded()), this, SLOT(populateEntries()));
+	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(entryAdded(quint64)), this, SLOT(addEntry(quint64)));
+	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(entryModified(quint64)), this, SLOT(modifyEntry(quint64)));
+	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(entryRemoved(quint64)), this, SLOT(removeEntry(quint64)));
+	connect(HistoryManager::getBrowsingHistoryModel(), SIGNAL(entriesRemoved(QVector<quint64>)), this, SLOT(populateEntries()));
 	connect(HistoryManager::getInstance(), SIGNAL(dayChanged()), this, SLOT(populateEntries()));
 	connect(m_ui->filterLineEdit, SIGNAL(textChanged(QString)), m_ui->historyViewWidget, SLOT(setFilterString(QString)));
 	connect(m_ui->historyViewWidget, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(openEntry(QModelIndex)));
@@ -134,7 +136,7 @@ void HistoryContentsWidget::populateEntries()
 
 	for (int i = 0; i < model->rowCount(); ++i)
 	{
-		addEntry(static_cast<HistoryEntryItem*>(model->item(i, 0)));
+		addEntry(model->index(i, 0).data(HistoryModel::IdentifierRole).toULongLong());
 	}
 
 	const QString expandBranches(SettingsManager::getOption(SettingsManager::History_ExpandBranchesOption).toString());
@@ -163,9 +165,16 @@ void HistoryContentsWidget::populateEntries()
 	emit loadingStateChanged(WebWidget::FinishedLoadingState);
 }
 
-void HistoryContentsWidget::addEntry(HistoryEntryItem *entry)
+void HistoryContentsWidget::addEntry(quint64 identifier)
 {
-	if (!entry || entry->data(HistoryModel::IdentifierRole).toULongLong() == 0 || findEntry(entry->data(HistoryModel::IdentifierRole).toULongLong()))
+	if (identifier == 0 || findEntry(identifier))
+	{
+		return;
+	}
+
+	const HistoryModel::HistoryEntry entry(HistoryManager::getEntry(identifier));
+
+	if (!entry.isValid())
 	{
 		return;
 	}
@@ -176,7 +185,7 @@ void HistoryContentsWidget::addEntry(HistoryEntryItem *entry)
 	{
 		groupItem = m_model->item(i, 0);
 
-		if (groupItem && (entry->data(HistoryModel::TimeVisitedRole).toDateTime().date() >= groupItem->data(Qt::UserRole).toDate() || !groupItem->data(Qt::UserRole).toDate().isValid()))
+		if (groupItem && (entry.timeVisited.date() >= groupItem->data(Qt::UserRole).toDate() || !groupItem->data(Qt::UserRole).toDate().isValid()))
 		{
 			break;
 		}
@@ -189,8 +198,8 @@ void HistoryContentsWidget::addEntry(HistoryEntryItem *entry)
 		return;
 	}
 
-	QList<QStandardItem*> entryItems({new QStandardItem((entry->icon().isNull() ? ThemesManager::createIcon(QLatin1String("text-html")) : entry->icon()), entry->data(HistoryModel::UrlRole).toUrl().toDisplayString().replace(QLatin1String("%23"), QString(QLatin1Char('#')))), new QStandardItem(entry->data(HistoryModel::TitleRole).isNull() ? tr("(Untitled)") : entry->data(HistoryModel::TitleRole).toString()), new QStandardItem(Utils::formatDateTime(entry->data(HistoryModel::TimeVisitedRole).toDateTime()))});
-	entryItems[0]->setData(entry->data(HistoryModel::IdentifierRole).toULongLong(), Qt::UserRole);
+	QList<QStandardItem*> entryItems({new QStandardItem((entry.icon.isNull() ? ThemesManager::createIcon(QLatin1String("text-html")) : entry.icon), entry.url.toDisplayString().replace(QLatin1String("%23"), QString(QLatin1Char('#')))), new QStandardItem(entry.title.isEmpty() ? tr("(Untitled)") : entry.title), new QStandardItem(Utils::formatDateTime(entry.timeVisited))});
+	entryItems[0]->setData(entry.identifier, Qt::UserRole);
 	entryItems[0]->setFlags(entryItems[0]->flags() | Qt::ItemNeverHasChildren);
 	entryItems[1]->setFlags(entryItems[1]->flags() | Qt::ItemNeverHasChildren);
 	entryItems[2]->setFlags(entryItems[2]->flags() | Qt::ItemNeverHasChildren);
@@ -215,36 +224,38 @@ void HistoryContentsWidget::addEntry(HistoryEntryItem *entry)
 	}
 }
 
-void HistoryContentsWidget::modifyEntry(HistoryEntryItem *entry)
+void HistoryContentsWidget::modifyEntry(quint64 identifier)
 {
-	if (!entry || entry->data(HistoryModel::IdentifierRole).toULongLong() == 0)
+	const HistoryModel::HistoryEntry entry(HistoryManager::getEntry(identifier));
+
+	if (!entry.isValid())
 	{
 		return;
 	}
 
-	QStandardItem *entryItem(findEntry(entry->data(HistoryModel::IdentifierRole).toULongLong()));
+	QStandardItem *entryItem(findEntry(identifier));
 
 	if (!entryItem)
 	{
-		addEntry(entry);
+		addEntry(identifier);
 
 		return;
 	}
 
-	entryItem->setIcon(entry->icon().isNull() ? ThemesManager::createIcon(QLatin1String("text-html")) : entry->icon());
-	entryItem->setText(entry->data(HistoryModel::UrlRole).toUrl().toDisplayString());
-	entryItem->parent()->child(entryItem->row(), 1)->setText(entry->data(HistoryModel::TitleRole).isNull() ? tr("(Untitled)") : entry->data(HistoryModel::TitleRole).toString());
-	entryItem->parent()->child(entryItem->row(), 2)->setText(Utils::formatDateTime(entry->data(HistoryModel::TimeVisitedRole).toDateTime()));
+	entryItem->setIcon(entry.icon.isNull() ? ThemesManager::createIcon(QLatin1String("text-html")) : entry.icon);
+	entryItem->setText(entry.url.toDisplayString());
+	entryItem->parent()->child(entryItem->row(), 1)->setText(entry.title.isEmpty() ? tr("(Untitled)") : entry.title);
+	entryItem->parent()->child(entryItem->row(), 2)->setText(Utils::formatDateTime(entry.timeVisited));
 }
 
-void HistoryContentsWidget::removeEntry(HistoryEntryItem *entry)
+void HistoryContentsWidget::removeEntry(quint64 identifier)
 {
-	if (!entry || entry->data(HistoryModel::IdentifierRole).toULongLong() == 0)
+	if (identifier == 0)
 	{
 		return;
 	}
 
-	QStandardItem *entryItem(findEntry(entry->data(HistoryModel::IdentifierRole).toULongLong()));
+	QStandardItem *entryItem(findEntry(identifier));
 
 	if (entryItem)
 	{
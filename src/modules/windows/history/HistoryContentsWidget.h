@@ -61,9 +61,9 @@ protected:
 
 protected slots:
 	void populateEntries();
-	void addEntry(HistoryEntryItem *entry);
-	void modifyEntry(HistoryEntryItem *entry);
-	void removeEntry(HistoryEntryItem *entry);
+	void addEntry(quint64 identifier);
+	void modifyEntry(quint64 identifier);
+	void removeEntry(quint64 identifier);
 	void removeEntry();
 	void removeDomainEntries();
 	void openEntry(const QModelIndex &index = {});